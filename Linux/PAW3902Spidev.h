@@ -0,0 +1,269 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __PAW3902SPIDEV_H
+#define __PAW3902SPIDEV_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+#include <chrono>
+#include "../PAW3902/PAW3902Core.h"
+
+// Linux spidev transport for PAW3902Core. Register accesses are queued as
+// spi_ioc_transfer segments and go out together in one SPI_IOC_MESSAGE ioctl:
+//
+//   write   one 2-byte segment, cs_change so nCS rises before the next access
+//   read    address segment with delay_usecs = tSRAD, then the data segment;
+//           queued writes ride along in the same message
+//   delays  tSWW/tSRR and table settle delays are added to the last
+//           segment's delay_usecs while a transaction is open, so a whole
+//           register table is one syscall
+//   gaps    the tSWW/tSRR gap ending a message is cut from it and only
+//           waited out, if the syscall has not covered it yet, before the
+//           next message (PAW3902_DEADLINE_GAPS)
+//   burst   0x16 plus the 12-byte payload, one message
+//   frames  0x58 polls are read ahead PAW3902_SPIDEV_PREFETCH at a time, see
+//           streamRead()
+//
+// Outside a transaction delays sleep on the calling thread.
+
+#define PAW3902_SPIDEV_SEGMENTS 256 // spi_ioc_transfer slots per message
+#define PAW3902_SPIDEV_BYTES    512 // tx/rx bytes per message, well under spidev's default 4096 bufsiz
+#define PAW3902_SPIDEV_PREFETCH  64 // 0x58 polls per frame message
+
+// The system calls the bus makes; the host bench swaps in a fake node
+// (host/FakeSpidev.h)
+struct PAW3902LinuxSys {
+  static int ioctl(int fd, unsigned long request, void * arg) { return ::ioctl(fd, request, arg); }
+
+  // nanosleep() overshoots by tens of us, so short waits spin
+  static void sleepMicros(uint32_t us)
+  {
+    if(us < 100)
+    {
+      uint32_t start = micros();
+      while(micros() - start < us) { }
+      return;
+    }
+    struct timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+  }
+
+  static uint32_t micros()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+  }
+
+  // Profiling clock, ns
+  static uint32_t ticks() { return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+};
+
+// Open a spidev node in the sensor's SPI mode 3, 8 bits, at most 2 MHz;
+// returns the fd or -1
+static inline int paw3902SpidevOpen(const char * path, uint32_t clock = 2000000)
+{
+  uint8_t mode = SPI_MODE_3, bits = 8;
+  int fd = open(path, O_RDWR);
+  if(fd < 0) return -1;
+  if(ioctl(fd, SPI_IOC_WR_MODE, &mode) < 0 || ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+     ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &clock) < 0)
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+template <class Sys = PAW3902LinuxSys>
+class PAW3902SpidevBus {
+public:
+  PAW3902SpidevBus(int fd)
+    : transactions(0), syscalls(0), segments(0), bytes(0), errors(0),
+      _fd(fd), _count(0), _used(0), _open(false), _streamReg(0), _streamPos(0), _streamLength(0),
+      _tailGap(0), _gapStart(0), _gap(0) { }
+
+  // spidev has no manual chip select: an empty transfer holds it low for 1 ms
+  void begin()
+  {
+    Sys::sleepMicros(1000);
+    segment(NULL, NULL, 0, 1000, false);
+    flush();
+    Sys::sleepMicros(1000);
+  }
+
+  void beginTransaction() { _open = true; transactions++; }
+  void endTransaction()   { flush(); _open = false; }
+
+  void write(uint8_t reg, uint8_t value)
+  {
+    _streamPos = _streamLength = 0; // polls read ahead belong to a grab this write may restart
+    uint8_t * tx = reserve(2);
+    tx[0] = reg | 0x80; // register write must have a 1 in bit 7 position
+    tx[1] = value;
+    segment(tx, NULL, 2, 1 + PAW3902_tSWW, true);
+    _tailGap = PAW3902_tSWW;
+    if(!_open) flush();
+  }
+
+  uint8_t read(uint8_t reg)
+  {
+    uint8_t * tx = reserve(2);
+    tx[0] = reg & 0x7F;
+    tx[1] = 0;
+    segment(tx, NULL, 1, PAW3902_tSRAD, false);
+    segment(NULL, tx + 1, 1, 1 + PAW3902_tSRR, true);
+    _tailGap = PAW3902_tSRR;
+    flush();
+    return tx[1]; // flush() leaves the buffer contents alone
+  }
+
+  void readBurst(uint8_t * dataArray)
+  {
+    transactions++;
+    uint8_t * tx = reserve(13);
+    tx[0] = 0x16;
+    memset(tx + 1, 0xFF, 12); // MOSI held high during the burst
+    segment(tx, NULL, 1, PAW3902_tSRAD, false);
+    segment(tx + 1, dataArray, 12, 1 + PAW3902_tSRR, true);
+    _tailGap = PAW3902_tSRR;
+    flush();
+  }
+
+  // Each 0x58 read hands out the next value of the grab in order, so polls
+  // can be read ahead in one message and served from the buffer. Left-over
+  // polls carry over to the next slice until a register write; at the end of
+  // a frame they are dropped unread.
+  void beginStream() { transactions++; }
+
+  uint8_t streamRead(uint8_t reg)
+  {
+    if(_streamPos == _streamLength || reg != _streamReg)
+    {
+      flush();
+      _streamTx = reg;
+      for(uint8_t ii = 0; ii < PAW3902_SPIDEV_PREFETCH; ii++)
+      {
+        segment(&_streamTx, NULL, 1, PAW3902_tSRAD, false);
+        segment(NULL, &_stream[ii], 1, PAW3902_tSRR, false);
+      }
+      _tailGap = PAW3902_tSRR;
+      flush();
+      _streamReg = reg;
+      _streamPos = 0;
+      _streamLength = PAW3902_SPIDEV_PREFETCH;
+    }
+    return _stream[_streamPos++];
+  }
+
+  void endStream() { }
+
+  bool settle(uint8_t ms) { delayMicros(1000UL * ms); return false; }
+
+  void delayMicros(uint32_t us)
+  {
+    if(_open && _count && _xfer[_count - 1].delay_usecs + us <= 0xFFFF)
+    {
+      _xfer[_count - 1].delay_usecs += us;
+      _tailGap = 0; // the settle delay runs through the gap
+      return;
+    }
+    flush();
+    Sys::sleepMicros(us);
+  }
+
+  void delayMillis(uint32_t ms) { delayMicros(1000UL * ms); }
+  uint32_t micros() { return Sys::micros(); }
+  uint32_t ticks() { return Sys::ticks(); }
+  uint32_t ticksPerMicro() { return 1000; }
+
+  void resetCounters() { transactions = 0; syscalls = 0; segments = 0; bytes = 0; errors = 0; }
+
+  uint32_t transactions; // bus claims
+  uint32_t syscalls;     // SPI_IOC_MESSAGE ioctls
+  uint32_t segments;     // spi_ioc_transfer segments in them
+  uint32_t bytes;        // bytes clocked
+  uint32_t errors;       // failed ioctls
+
+private:
+  int _fd;
+  struct spi_ioc_transfer _xfer[PAW3902_SPIDEV_SEGMENTS];
+  uint8_t _data[PAW3902_SPIDEV_BYTES];
+  uint16_t _count, _used;
+  bool _open;
+  uint8_t _streamTx, _streamReg, _streamPos, _streamLength;
+  uint8_t _stream[PAW3902_SPIDEV_PREFETCH];
+  uint8_t _tailGap;   // gap at the end of the queued message
+  uint32_t _gapStart; // Sys::micros() after the last message
+  uint8_t _gap;       // us the next message has to wait after it
+
+  // Room for one access: length data bytes and two segments
+  uint8_t * reserve(uint16_t length)
+  {
+    if(_used + length > PAW3902_SPIDEV_BYTES || _count + 2 > PAW3902_SPIDEV_SEGMENTS) flush();
+    uint8_t * p = &_data[_used];
+    _used += length;
+    return p;
+  }
+
+  void segment(const uint8_t * tx, uint8_t * rx, uint32_t length, uint16_t delayMicros, bool deselect)
+  {
+    struct spi_ioc_transfer & t = _xfer[_count++];
+    memset(&t, 0, sizeof(t));
+    t.tx_buf = (uintptr_t)tx;
+    t.rx_buf = (uintptr_t)rx;
+    t.len = length;
+    t.delay_usecs = delayMicros;
+    t.cs_change = deselect;
+    bytes += length;
+    _tailGap = 0;
+  }
+
+  void flush()
+  {
+    if(!_count) return;
+    _xfer[_count - 1].cs_change = 0; // on the last segment cs_change would hold nCS low after the message
+#if PAW3902_DEADLINE_GAPS
+    _xfer[_count - 1].delay_usecs -= _tailGap;
+    uint32_t remaining = paw3902GapRemaining(_gapStart, Sys::micros(), _gap);
+    if(remaining) Sys::sleepMicros(remaining);
+#endif
+    if(Sys::ioctl(_fd, _IOC(_IOC_WRITE, SPI_IOC_MAGIC, 0, _count * sizeof(struct spi_ioc_transfer)), _xfer) < 0) errors++;
+#if PAW3902_DEADLINE_GAPS
+    _gapStart = Sys::micros();
+    _gap = _tailGap;
+#endif
+    _tailGap = 0;
+    syscalls++;
+    segments += _count;
+    _count = 0;
+    _used = 0;
+  }
+};
+
+#endif //__PAW3902SPIDEV_H
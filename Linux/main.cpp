@@ -0,0 +1,102 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* PAW3902 on a Linux board through spidev, e.g.
+ *
+ *     g++ -std=c++11 -O2 Linux/main.cpp -o paw3902 && ./paw3902 /dev/spidev0.0
+ *
+ * The motion line is not wired up here, so the sensor is polled: a burst
+ * every POLL_MICROS, with the same light mode switching as the other ports.
+ * Once a second the bus counters show what the batching saves.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "PAW3902Spidev.h"
+#include "../PAW3902/LightModeController.h"
+#include "../PAW3902/MotionAccumulator.h"
+
+#define POLL_MICROS 10000 // 100 Hz, the sensor reports up to 126 Hz
+
+int main(int argc, char ** argv)
+{
+  const char * path = argc > 1 ? argv[1] : "/dev/spidev0.0";
+  int fd = paw3902SpidevOpen(path);
+  if(fd < 0) { perror(path); return 1; }
+
+  PAW3902Core<PAW3902SpidevBus<> > opticalFlow((PAW3902SpidevBus<>(fd)));
+  LightModeController lightMode;
+  MotionAccumulator motionAccumulator;
+  PAW3902Sample sample;
+  MotionTotals totals;
+  uint8_t productID, revisionID, inverseProductID;
+
+  opticalFlow.begin();
+
+  // Check device ID as a test of SPI communications
+  bool ok = opticalFlow.checkID(&productID, &revisionID, &inverseProductID);
+  printf("Product ID = 0x%x, should be 0x49\n", productID);
+  printf("Revision ID = 0x0%x\n", revisionID);
+  printf("Inverse Product ID = 0x%x, should be 0xB6\n", inverseProductID);
+  if(!ok) { printf("Initialization of the opticalFlow sensor failed\n"); return 1; }
+
+  opticalFlow.setMode(bright);
+  lightModeInit(&lightMode, NULL); // default thresholds, pass a LightModeConfig to tune
+  memset(&motionAccumulator, 0, sizeof(motionAccumulator));
+
+  uint32_t next = opticalFlow.bus().micros(), report = next;
+  while(1)
+  {
+    opticalFlow.readSample(&sample);
+    lightModeRate(&lightMode, &sample); // confidence and validity, the counts stay as read
+    motionAccumulate(&motionAccumulator, &sample);
+
+    uint8_t newMode = lightModeUpdate(&lightMode, &sample);
+    if(newMode != LIGHTMODE_HOLD) opticalFlow.switchMode(newMode);
+
+    if(sample.deltaX || sample.deltaY)
+      printf("X: %d, Y: %d, SQUAL: %u, Shutter: 0x%x, mode: %u, confidence: %u%s\n", sample.deltaX, sample.deltaY, sample.SQUAL,
+             sample.Shutter, sample.mode, sample.confidence, sample.valid ? "" : " (under thresholds)");
+
+    if(sample.timestamp - report >= 1000000)
+    {
+      PAW3902SpidevBus<> & bus = opticalFlow.bus();
+      motionTake(&motionAccumulator, &totals);
+      printf("Total X: %ld, Y: %ld, samples: %lu, ioctls: %u, segments: %u, errors: %u\n", (long)totals.deltaX, (long)totals.deltaY,
+             (unsigned long)totals.samples, bus.syscalls, bus.segments, bus.errors);
+      bus.resetCounters();
+#if PAW3902_PROFILE
+      char line[120];
+      for(uint8_t op = 0; op < PAW3902_OPS; op++)
+      {
+        paw3902FormatProfile(line, sizeof(line), op, &opticalFlow.getProfile(op), opticalFlow.ticksPerMicro());
+        printf("  %s\n", line);
+      }
+#endif
+      report = sample.timestamp;
+    }
+
+    next += POLL_MICROS;
+    int32_t wait = (int32_t)(next - opticalFlow.bus().micros());
+    if(wait > 0) PAW3902LinuxSys::sleepMicros(wait);
+  }
+}
@@ -48,31 +48,78 @@
 #include "lp.h"
 #include "icc.h"
 #include "PAW3902.h"
+#include "../PAW3902/MotionRing.h"
+#include "../PAW3902/MotionAccumulator.h"
+#include "../PAW3902/LightModeController.h"
+#include "../PAW3902/Telemetry.h"
+#include "../PAW3902/SensorScheduler.h"
+#include "../PAW3902/VelocityEstimator.h"
+#include "../PAW3902/PowerManager.h"
 
 // Pin definitions
 #define RST    21  // PAM3902 reset
 #define MOT    PIN_2  // use as data ready interrupt
-#define PAW3902_intPin PIN_2
+#define PAW3902_intPins { MOT } // one motion interrupt per sensor on port 0, in PAW3902_CS_PINS order
 
 #define CLOCK_DIVIDER     0    // Divide by 2^n
 
+#define BURST_TIMING      0    // 1 = time each burst read with the DWT cycle counter and print it with every sample
+#define ISR_ACQUISITION   1    // 1 = read each burst in the motion interrupt, 0 = flag it and read in the loop
+#define TELEMETRY_BINARY  0    // 1 = COBS framed binary samples on the console UART (host/telemetry_decode), 0 = text
+#define SENSOR_POLICY     SENSOR_SCHED_ROUND_ROBIN // order waiting sensors are read in, see SensorScheduler.h
+#define SENSOR_HEIGHT_MM  0    // sensor height above the ground for velocity output (VelocityEstimator.h), 0 = off
+#define POWER_IDLE_MS     0    // shut a sensor down after this long without motion (PowerManager.h), 0 = always on
+#define POWER_WAKE_MS     500  // ... and wake it this often to look for motion
+#define TICK_HZ           10   // SysTick wakes the loop this often for reports and power polling
+#define REPORT_TICKS      10   // text report every this many ticks
+
 /***** Globals *****/
-spi_req_t req;
-volatile int spi_flag;
-uint8_t tx_data[16], rx_data[16];
+uint32_t burstCycles = 0;
 
 volatile uint8_t mode = lowlight;
 int16_t deltaX, deltaY, Shutter;
-volatile int motionDetect = 0, alarmFlag = 0;
-
-uint8_t frameArray[1225], dataArray[12], SQUAL, RawDataSum = 0;
-uint8_t count0 = 0, count1 = 0, count2 = 0, count3 = 0, iterations = 0;
+volatile int alarmFlag = 0;
+
+uint8_t frameArray[1225], SQUAL, RawDataSum = 0;
+uint8_t newMode, iterations = 0;
+
+MotionRing motionRing; // decoded samples from the motion interrupt, drained by the main loop
+LightModeController lightMode[PAW3902_SENSORS]; // shutter/RawDataSum hysteresis, see LightModeController.h
+MotionAccumulator motionAccumulator[PAW3902_SENSORS]; // every sample summed between reports, see motionTake()
+SensorScheduler sensorSched; // which sensor's burst to read next, see serviceSensors()
+SensorStats sensorStats[PAW3902_SENSORS], sensorTotal;
+#if SENSOR_HEIGHT_MM
+VelocityEstimator velocity[PAW3902_SENSORS]; // ground speed per sensor from every sample, low SQUAL weighted down
+#endif
+#if POWER_IDLE_MS
+PowerManager power[PAW3902_SENSORS]; // when to shut each sensor down and wake it, call powerTrigger() from any other wake source
+PowerStats powerStats;
+#endif
+PAW3902Sample sample;
+MotionTotals totals;
+const uint32_t intPins[PAW3902_SENSORS] = PAW3902_intPins;
+TelemetryEncoder telemetry;
+uint8_t telemetrySeq = 0;
+
+// CPU sleep and wake-to-data latency on the TMR2 timebase, see sleepUntilEvent()
+typedef struct {
+	uint32_t windowStart;            // us
+	uint32_t asleepMicros;
+	uint32_t wakes, motionWakes;     // all wakes, and those a motion interrupt ended
+	uint32_t wokeAt;                 // us, end of the last motion wake's sleep
+	volatile uint8_t waiting;        // no burst read since that wake
+	uint32_t dataWakes, dataMicros, maxDataMicros; // motion wake to the end of the burst read: count, total, worst
+} SleepStats;
+SleepStats sleepStats, sleepWindow;
+volatile uint8_t ticks = 0;       // SysTick interrupts not yet handled by the loop
+volatile uint8_t consoleByte = 0; // last byte received on the console, 0 once handled
+uint8_t reportTicks = 0;
 
 /***** Functions *****/
 /******************************************************************************/
-void spi_cb(void *req, int error)
+void telemetryWrite(const uint8_t * data, uint16_t length)
 {
-    spi_flag = error;
+	UART_Write(MXC_UART_GET_UART(CONSOLE_UART), (uint8_t *)data, length);
 }
 
 void SPI0_IRQHandler(void)
@@ -80,6 +127,25 @@ void SPI0_IRQHandler(void)
 	SPI_Handler(SPI0A);
 }
 
+void GPIO0_IRQHandler(void)
+{
+	GPIO_Handler(PORT_0); // dispatches to PAW3902_intHandler() per pin
+}
+
+void tickHandler(void)
+{
+	ticks++;
+}
+
+// Keeps the last byte for the loop; reading the FIFO here stops the level
+// triggered interrupt from firing again before the loop gets to run
+void consoleHandler(void)
+{
+	mxc_uart_regs_t * uart = MXC_UART_GET_UART(CONSOLE_UART);
+	while(UART_NumReadAvail(uart)) consoleByte = UART_ReadByte(uart);
+	UART_ClearFlags(uart, MXC_F_UART_INT_FL_RX_FIFO_THRESH);
+}
+
 void delayMicroseconds(uint32_t time_us)
 {
 	TMR_Delay(MXC_TMR0, USEC(time_us), NULL); // TMR timer delay
@@ -90,93 +156,128 @@ void delay(uint32_t time_ms)
 	TMR_Delay(MXC_TMR0, MSEC(time_ms), NULL); // TMR timer delay
 }
 
+uint32_t micros(void)
+{
+	return TMR_TO_Elapsed(MXC_TMR2); // TMR2 free-runs from main() as the sample timebase
+}
+
 void ledBlink(uint32_t duration)
 {
 	  LED_On(0); delay(duration); LED_Off(0);
 }
 
-void PAW3902_intHandler()
+// Read every sensor that has raised its motion interrupt, in scheduler order.
+// Only ever runs in one context (the port 0 interrupt or the main loop), which
+// keeps the sensors' bursts on SPI0 from overlapping.
+void serviceSensors(void)
 {
-	motionDetect = 1;
+	PAW3902Sample newSample;
+	uint8_t sensor;
+	while((sensor = sensorSchedNext(&sensorSched)) != SENSOR_SCHED_NONE)
+	{
+#if BURST_TIMING
+	uint32_t burstStart = DWT->CYCCNT;
+#endif
+	readSampleSensor(sensor, &newSample);
+#if BURST_TIMING
+	burstCycles = DWT->CYCCNT - burstStart;
+#endif
+	if(sleepStats.waiting) // first burst since a motion interrupt woke the CPU
+	{
+		uint32_t latency = micros() - sleepStats.wokeAt;
+		sleepStats.dataWakes++;
+		sleepStats.dataMicros += latency;
+		if(latency > sleepStats.maxDataMicros) sleepStats.maxDataMicros = latency;
+		sleepStats.waiting = 0;
+	}
+	sensorSchedDone(&sensorSched, sensor, &newSample);
+	motionRingPush(&motionRing, &newSample);
+	motionAccumulate(&motionAccumulator[sensor], &newSample);
+	}
 }
 
-void writeByte(uint8_t reg, uint8_t value)
+void PAW3902_intHandler(void * cbdata)
 {
-  req.width = SPI17Y_WIDTH_1;
-  req.ssel = 0;
-  req.ssel_pol = SPI17Y_POL_LOW;
-  req.bits = 8;
-  req.len = 2;
-  req.callback = spi_cb;
-
-  uint16_t temp = (value << 8);
-  tx_data[0] =  (temp | (reg | 0x80)); // register write must have a 1 in bit 7 position
-  req.tx_data = &tx_data;
-  req.deass = 1;     // don't keep nCS asserted after transaction
-  uint8_t error = 0;
-  if((error = SPI_MasterTrans(SPI0A, &req)) != 0) {printf("Error writing %d\n", error);}
+	sensorSchedRaise(&sensorSched, (uint8_t)(uintptr_t)cbdata, micros()); // cbdata is the sensor index
+#if ISR_ACQUISITION
+	serviceSensors();
+#endif
 }
 
-void writeByteDelay(uint8_t reg, uint8_t value)
+// switchMode() shares the SPI request buffers with the motion interrupt, so keep
+// the interrupt masked while it runs
+void changeMode(uint8_t sensor, uint8_t newMode)
 {
-  writeByte(reg, value);
-  delayMicroseconds(11);
+	if(newMode == getModeSensor(sensor)) return; // samples still queued from before the switch
+	NVIC_DisableIRQ(MXC_GPIO_GET_IRQ(PORT_0));
+	switchModeSensor(sensor, newMode);
+	NVIC_EnableIRQ(MXC_GPIO_GET_IRQ(PORT_0));
 }
 
-uint8_t readByte(uint8_t reg)
+// Sleep until the next interrupt unless the loop has work waiting. Interrupts
+// stay masked from the check to the wake, so an edge landing after the check
+// still ends the sleep (WFI wakes on a pending interrupt even when masked) and
+// its handler runs only once the sleep has been timed. Sleep, not deep sleep:
+// TMR2, SPI0 and the 96 MHz clock keep running, so micros() stays valid and the
+// burst can start as soon as the handler does.
+void sleepUntilEvent(void)
 {
-  uint16_t temp = (0xFF << 8);
-  tx_data[0] = (temp | (reg | 0x7000)); // register read must have a 0 in bit 7 position
-  req.tx_data = &tx_data;
-  req.rx_data = &rx_data;
-  req.width = SPI17Y_WIDTH_1;
-  req.ssel = 0;
-  req.ssel_pol = SPI17Y_POL_LOW;
-  req.bits = 8;
-  req.len = 2;
-  req.callback = NULL;
-
-  req.deass = 1;     // keep nCS asserted after transaction
-  uint8_t error = 0;
-  if((error = SPI_MasterTrans(SPI0A, &req)) != 0) {printf("Error writing %d\n", error);}
-  delayMicroseconds(2);
-
-  return rx_data[0];
+	__disable_irq();
+	if(!ticks && !consoleByte && !motionRingCount(&motionRing)
+#if !ISR_ACQUISITION
+	   && !sensorSchedPending(&sensorSched)
+#endif
+	   )
+	{
+		uint32_t start = micros();
+		sleepStats.waiting = 0;
+		LP_EnterSleepMode();
+		uint32_t now = micros();
+		sleepStats.asleepMicros += now - start;
+		sleepStats.wakes++;
+		if(NVIC_GetPendingIRQ(MXC_GPIO_GET_IRQ(PORT_0)))
+		{
+			sleepStats.motionWakes++;
+			sleepStats.wokeAt = now;
+			sleepStats.waiting = 1;
+		}
+	}
+	__enable_irq();
 }
 
-void readBurstMode(uint8_t * dataArray)
+#if POWER_IDLE_MS
+// Shut a sensor down or wake it as its PowerManager asks. Its motion interrupt
+// is off while it is down, so the handler never reads a sensor that is not there.
+void servicePower(uint8_t sensor)
 {
-   /* Setup MOSI output pin. */
-   gpio_cfg_t gpio_MOSI;
-   gpio_MOSI.port = 0;
-   gpio_MOSI.mask = MOSI;
-   gpio_MOSI.pad = GPIO_PAD_NONE;
-   gpio_MOSI.func = GPIO_FUNC_OUT;
-   GPIO_Config(&gpio_MOSI);
-
-   tx_data[0] =  0x16; // register write must have a 1 in bit 7 position
-   req.tx_data = tx_data;
-   req.rx_data = rx_data;
-   req.width = SPI17Y_WIDTH_1;
-   req.ssel = 0;
-   req.bits = 8;
-   req.len = 1;
-   req.callback = NULL;
-
-   req.deass = 0;     // keep nCS asserted after transaction
-   SPI_MasterTrans(SPI0A, &req);
-   GPIO_OutSet(&gpio_MOSI); // hold MOSI high during burst read
-   delayMicroseconds(2);
-
-   for(uint8_t ii = 0; ii < 12; ii++)
-   {
-    SPI_MasterTrans(SPI0A, &req);
-    dataArray[ii] = rx_data[0];
-   }
-
-   GPIO_OutClr(&gpio_MOSI); // return MOSI to LOW
-   delayMicroseconds(1);
+	gpio_cfg_t mot = { PORT_0, intPins[sensor], GPIO_FUNC_IN, GPIO_PAD_PULL_DOWN };
+	switch(powerPoll(&power[sensor], micros()))
+	{
+	case POWER_SHUTDOWN:
+		NVIC_DisableIRQ(MXC_GPIO_GET_IRQ(PORT_0));
+		GPIO_IntDisable(&mot);
+		shutdownSensor(sensor);
+		NVIC_EnableIRQ(MXC_GPIO_GET_IRQ(PORT_0));
+#if !TELEMETRY_BINARY
+		powerTake(&power[sensor], micros(), &powerStats); // since the last shutdown
+		printf("Sensor %u shut down. Awake: %u.%u%%, wakes: %u (%u triggered, %u quiet)\n", sensor, powerStats.awakePermille / 10,
+		       powerStats.awakePermille % 10, powerStats.wakes, powerStats.triggered, powerStats.quiet);
+		printf("wake() max: %lu us, to first sample mean/max: %lu/%lu us, samples lost: %lu\n", (unsigned long)powerStats.maxWakeMicros,
+		       (unsigned long)powerStats.meanDataMicros, (unsigned long)powerStats.maxDataMicros, (unsigned long)powerStats.samplesLost);
+#endif
+		break;
+
+	case POWER_WAKE:
+		NVIC_DisableIRQ(MXC_GPIO_GET_IRQ(PORT_0));
+		wakeSensor(sensor); // reads Motion, which releases the pin
+		GPIO_IntClr(&mot);
+		GPIO_IntEnable(&mot);
+		powerAwake(&power[sensor], micros());
+		NVIC_EnableIRQ(MXC_GPIO_GET_IRQ(PORT_0));
+		break;
+	}
 }
+#endif
 
 //******************************************************************************
 
@@ -189,6 +290,7 @@ int main(void)
         printf("Error initializing SPI Master %d.  (Error code = %d)\n", SPI0A, error);
         return 1;
     }
+    NVIC_EnableIRQ(SPI0_IRQn);
 
 
     // delay before uart shutdown
@@ -215,112 +317,188 @@ int main(void)
 
 	ICC_Enable(); // enable instruction cache for higher efficiency
 
-	PAW3902begin();
+	TMR_SW_Start(MXC_TMR2, NULL); // sample timestamps, see micros()
+#if BURST_TIMING
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // start the DWT cycle counter
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+	telemetryInit(&telemetry, telemetryWrite);
 
+	for(uint8_t sensor = 0; sensor < PAW3902_SENSORS; sensor++)
+	{
 	  // Check device ID as a test of SPI communications
-      if (!checkID()) {
+      if (!PAW3902beginSensor(sensor)) {
       printf("Initialization of the opticalFlow sensor failed\n");
       printf(" \n");
       while(1) { }
       }
 
-      setMode(bright);
-
-      // Configure sensor interrupts
+      setModeSensor(sensor, bright);
+      lightModeInit(&lightMode[sensor], NULL); // default thresholds, pass a LightModeConfig to tune
+#if SENSOR_HEIGHT_MM
+      velocityInit(&velocity[sensor], NULL, SENSOR_HEIGHT_MM);
+#endif
+#if POWER_IDLE_MS
+      PowerConfig powerConfig = powerDefaults;
+      powerConfig.idleMicros = POWER_IDLE_MS * 1000UL;
+      powerConfig.wakeMicros = POWER_WAKE_MS * 1000UL;
+      powerInit(&power[sensor], &powerConfig, micros());
+#endif
+	}
+      sensorSchedInit(&sensorSched, PAW3902_SENSORS, SENSOR_POLICY, micros());
+
+      // Configure sensor interrupts, all on port 0 so one handler services them in turn
+	for(uint8_t sensor = 0; sensor < PAW3902_SENSORS; sensor++)
+	{
       gpio_cfg_t gpio_interrupt1;
       gpio_interrupt1.port = PORT_0;
-      gpio_interrupt1.mask = PAW3902_intPin;
+      gpio_interrupt1.mask = intPins[sensor];
       gpio_interrupt1.pad = GPIO_PAD_PULL_DOWN;
       gpio_interrupt1.func = GPIO_FUNC_IN;
       GPIO_Config(&gpio_interrupt1);
-      GPIO_RegisterCallback(&gpio_interrupt1, PAW3902_intHandler, 0);
+      GPIO_RegisterCallback(&gpio_interrupt1, PAW3902_intHandler, (void *)(uintptr_t)sensor);
       GPIO_IntConfig(&gpio_interrupt1, GPIO_INT_EDGE, GPIO_INT_RISING);
       GPIO_IntEnable(&gpio_interrupt1);
-      NVIC_EnableIRQ(MXC_GPIO_GET_IRQ(PORT_0));
       LP_EnableGPIOWakeup(&gpio_interrupt1);
+	}
+      NVIC_SetPriority(MXC_GPIO_GET_IRQ(PORT_0), 1); // below SPI0 so the burst completes inside the handler
+      NVIC_EnableIRQ(MXC_GPIO_GET_IRQ(PORT_0));
+
+      // The other wake sources: a SysTick for reports and power polling, and console input
+      NVIC_SetVector(SysTick_IRQn, tickHandler);
+      SysTick_Config(SystemCoreClock / TICK_HZ);
+      mxc_uart_regs_t * console = MXC_UART_GET_UART(CONSOLE_UART);
+      NVIC_SetVector(MXC_UART_GET_IRQ(CONSOLE_UART), consoleHandler);
+      console->int_en |= MXC_F_UART_INT_EN_RX_FIFO_THRESH;
+      NVIC_SetPriority(MXC_UART_GET_IRQ(CONSOLE_UART), 2); // never delays a burst
+      NVIC_EnableIRQ(MXC_UART_GET_IRQ(CONSOLE_UART));
+      sleepStats.windowStart = micros();
 
 
     while(1)  // main do loop
     	 {
 
     	  // Navigation
-    	  if(motionDetect)
+#if !ISR_ACQUISITION
+    	  serviceSensors();
+#endif
+
+    	  if(motionRingCount(&motionRing)) iterations++; // count loop passes with motion, not samples
+
+    	  while(motionRingPop(&motionRing, &sample))
     	  {
-    	   motionDetect = 0;
-    	   iterations++;
-
-    	   readBurstMode(dataArray);
-    	   deltaX = ((int16_t)dataArray[3] << 8) | dataArray[2];
-    	   deltaY = ((int16_t)dataArray[5] << 8) | dataArray[4];
-    	   SQUAL = dataArray[6];
-    	   RawDataSum = dataArray[7];
-    	   Shutter = ((uint16_t)dataArray[10] << 8) | dataArray[11];
-    	   Shutter &= 0x1FFF;
-
-    	   mode =    getMode();
-    	   // Don't report data if under thresholds
-    	   if((mode == bright       ) && (SQUAL < 25) && (Shutter >= 0x1FF0)) deltaX = deltaY = 0;
-    	   if((mode == lowlight     ) && (SQUAL < 70) && (Shutter >= 0x1FF0)) deltaX = deltaY = 0;
-    	   if((mode == superlowlight) && (SQUAL < 85) && (Shutter >= 0x0BC0)) deltaX = deltaY = 0;
+    	   deltaX = sample.deltaX;
+    	   deltaY = sample.deltaY;
+    	   SQUAL = sample.SQUAL;
+    	   RawDataSum = sample.RawDataSum;
+    	   Shutter = sample.Shutter;
+
+    	   mode =    sample.mode;
+    	   lightModeRate(&lightMode[sample.sensor], &sample); // confidence and validity, the counts are passed on as read
+#if POWER_IDLE_MS
+    	   powerSample(&power[sample.sensor], &sample);
+#endif
+#if SENSOR_HEIGHT_MM
+    	   velocityUpdate(&velocity[sample.sensor], &sample); // weighs each sample by its confidence
+#endif
 
     	   // Switch brightness modes automagically
+    	   newMode = lightModeUpdate(&lightMode[sample.sensor], &sample);
+    	   if(newMode != LIGHTMODE_HOLD) changeMode(sample.sensor, newMode);
+
+#if TELEMETRY_BINARY
+    	   telemetrySendMotion(&telemetry, &sample, telemetrySeq++); // 19 bytes, gaps in seq count ring overruns
+#else
+#if PAW3902_SENSORS > 1
+    	   printf("Sensor %u, t = %lu us, ", sample.sensor, (unsigned long)sample.timestamp);
+#endif
+    	   printf("X: %d", deltaX); printf(", Y: %d", deltaY);
+    	   printf(", confidence: %u%s\n", sample.confidence, sample.valid ? "" : " (under thresholds)");
+#if SENSOR_HEIGHT_MM
+    	   printf("Velocity X: %ld, Y: %ld mm/s\n", (long)velocityMillimetresPerSecond(velocity[sample.sensor].vx),
+    	          (long)velocityMillimetresPerSecond(velocity[sample.sensor].vy));
+#endif
+    	   printf("SQUAL: %u", SQUAL);printf(", Shutter: 0x%x\n", Shutter);
+    	   printf("RawDataSum: 0x%x", RawDataSum);printf(", mode: %x", mode);printf(", overruns: %u\n", (unsigned int)motionRing.overruns);
+#if BURST_TIMING
+    	   printf("Burst read: %u us, %u cycles\n", (unsigned int)(burstCycles / (SystemCoreClock / 1000000)), (unsigned int)burstCycles);
+#endif
+    	   printf("  \n");
+#endif
+#if !ISR_ACQUISITION
+    	   serviceSensors(); // a burst waits for at most one sample's output
+#endif
+    	  }
 
-    	   // switch from lowlight to bright when shutter value < 3000 for 10 iterations
-    	   if((mode == lowlight) && (Shutter < 0x0BB8))
-    	   {
-    	       count0++;
-    	       if(count0 >= 10) setMode(bright);
-    	   }
-    	   else
-    	   {
-    	       count0 = 0;
-    	   }
-
-    	   // switch from superlowlight to lowlight when shutter value < 1000 for ten iterations
-    	   if((mode == superlowlight) && (Shutter < 0x03E8))
-    	   {
-    	       count1++;
-    	       if(count1 >= 10) setMode(lowlight);
-    	   }
-    	   else
-    	   {
-    	       count1 = 0;
-    	   }
+    	  // Console commands: p for a timing dump, w to wake sensors that are shut down
+    	  uint8_t command = consoleByte;
+    	  consoleByte = 0;
+#if PAW3902_PROFILE
+    	  if(command == 'p' || PB_Get(0)) printProfile(); // or hold the button
+#endif
 
+#if POWER_IDLE_MS
+    	  for(uint8_t sensor = 0; sensor < PAW3902_SENSORS; sensor++)
+    	  {
+    	   if(command == 'w') powerTrigger(&power[sensor], micros());
+    	   servicePower(sensor);
+    	  }
+#endif
+    	  (void)command;
 
-    	   // switch from bright to lowlight when shutter value >= 7711 for ten iterations
-    	   if((mode == bright) && (Shutter >= 0x1E1F) && (RawDataSum < 0x3C))
-    	   {
-    	       count2++;
-    	       if(count2 >= 10) setMode(lowlight);
-    	   }
-    	   else
-    	   {
-    	       count2 = 0;
-    	   }
+    	  // Everything below runs once a second off the tick, the loop sleeps in between
+    	  if(ticks)
+    	  {
+    	   __disable_irq();
+    	   ticks--; // one at a time, masked so a tick landing mid decrement is kept
+    	   __enable_irq();
+    	   LED_Off(0);
+    	  }
+    	  else
+    	  {
+    	   sleepUntilEvent();
+    	   continue;
+    	  }
+    	  if(++reportTicks < REPORT_TICKS) continue;
+    	  reportTicks = 0;
 
-    	   // switch from lowlight to superlowlight when shutter value >= 7711 for ten iterations
-    	   if((mode == lowlight) && (Shutter >= 0x1E1F) && (RawDataSum < 0x5A))
-    	   {
-    	       count3++;
-    	       if(count3 >= 10) setMode(superlowlight);
-    	   }
-    	   else
+    	  for(uint8_t sensor = 0; sensor < PAW3902_SENSORS; sensor++)
+    	  {
+    	   motionTake(&motionAccumulator[sensor], &totals); // displacement since the last report, nothing dropped
+#if !TELEMETRY_BINARY
+    	   if(totals.samples)
     	   {
-    	       count3 = 0;
+    	    printf("Sensor %u total X: %ld, Y: %ld, samples: %lu, SQUAL: %u-%u\n", sensor, (long)totals.deltaX, (long)totals.deltaY,
+    	           (unsigned long)totals.samples, totals.minSQUAL, totals.maxSQUAL);
     	   }
-
-    	   // Drop out of superlowlight mode as soon as the Shutter less than 500
-    	   if((mode == superlowlight) && (Shutter < 0x01F4)) setMode(lowlight);
-
-    	   printf("X: %.2f", deltaX); printf(", Y: %.2f\n", deltaY);
-    	   printf("SQUAL: %.2f", SQUAL);printf(", Shutter: 0x%x\n", Shutter);
-    	   printf("RawDataSum: 0x%x", RawDataSum);printf(", mode: %x\n", mode);
-    	   printf("  \n");
+#endif
     	  }
 
-    	ledBlink(100);
-        delay(900);
+#if !TELEMETRY_BINARY
+    	  // Read rate and worst interrupt-to-read latency per sensor since the last report,
+    	  // and the CPU's sleep; the handler updates the stats when it does the reading
+    	  NVIC_DisableIRQ(MXC_GPIO_GET_IRQ(PORT_0));
+    	  uint32_t now = micros();
+    	  sensorSchedTake(&sensorSched, now, sensorStats, &sensorTotal);
+    	  sleepWindow = sleepStats;
+    	  sleepStats.windowStart = now;
+    	  sleepStats.asleepMicros = sleepStats.wakes = sleepStats.motionWakes = 0;
+    	  sleepStats.dataWakes = sleepStats.dataMicros = sleepStats.maxDataMicros = 0;
+    	  NVIC_EnableIRQ(MXC_GPIO_GET_IRQ(PORT_0));
+    	  for(uint8_t sensor = 0; sensor < PAW3902_SENSORS; sensor++)
+    	  {
+    	   printf("Sensor %u: %lu samples/s, worst age %lu us, %lu coalesced\n", sensor, (unsigned long)sensorStats[sensor].samplesPerSecond,
+    	          (unsigned long)sensorStats[sensor].maxAgeMicros, (unsigned long)sensorStats[sensor].coalesced);
+    	  }
+    	  printf("All sensors: %lu samples/s, worst age %lu us\n", (unsigned long)sensorTotal.samplesPerSecond, (unsigned long)sensorTotal.maxAgeMicros);
+    	  uint32_t window = now - sleepWindow.windowStart;
+    	  uint32_t awakePermille = window ? (uint32_t)((window - sleepWindow.asleepMicros) * 1000ULL / window) : 1000;
+    	  printf("CPU awake: %lu.%lu%%, wakes: %lu (%lu motion), wake to data mean/max: %lu/%lu us\n", (unsigned long)awakePermille / 10,
+    	         (unsigned long)awakePermille % 10, (unsigned long)sleepWindow.wakes, (unsigned long)sleepWindow.motionWakes,
+    	         (unsigned long)(sleepWindow.dataWakes ? sleepWindow.dataMicros / sleepWindow.dataWakes : 0), (unsigned long)sleepWindow.maxDataMicros);
+
+    	  LED_On(0); // off at the next tick
+#endif // binary telemetry only sends samples
     	}
 
 }
@@ -0,0 +1,386 @@
+/*
+ * PAW3902.cpp
+ *
+ *  Created on: Nov 24, 2019
+ *      Author: kris
+ */
+
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "PAW3902.h"
+#include "../PAW3902/PAW3902Core.h"
+
+#ifndef PAW3902_BURST_ASYNC
+#define PAW3902_BURST_ASYNC 1 // 1 = async burst read with CPU asleep, 0 = byte at a time
+#endif
+
+#if PAW3902_BURST_ASYNC
+static volatile int burstBusy = 0;
+static volatile int burstError = E_NO_ERROR;
+
+static void burst_cb(void *req, int error)
+{
+  burstError = error;
+  burstBusy = 0;
+}
+#endif
+
+// SPI17Y transport for PAW3902Core. Each sensor's chip select is a port 0
+// GPIO that begin() takes over, so several sensors can share SPI0; it falls
+// with the first request of a command and rises after the one with deass = 1.
+// Motion bursts of different sensors must come from one context (see
+// SensorScheduler.h), since they share SPI0 and burst_cb().
+class PAW3902SPI17YBus {
+public:
+  PAW3902SPI17YBus() : _gapStart(0), _gap(0)
+  {
+    _cs.port = 0;
+    _cs.mask = CSPIN;
+    _cs.pad = GPIO_PAD_NONE;
+    _cs.func = GPIO_FUNC_OUT;
+  }
+
+  void setChipSelect(uint32_t mask) { _cs.mask = mask; }
+
+  void begin()
+  {
+    /* Setup chip select output pin. */
+    GPIO_Config(&_cs);
+
+    GPIO_OutSet(&_cs);
+    delay(1);
+    GPIO_OutClr(&_cs);
+    delay(1);
+    GPIO_OutSet(&_cs);
+    delay(1);
+
+    memset(_burstTx, 0xFF, sizeof(_burstTx)); // MOSI stays high during the burst payload
+
+#if PAW3902_PROFILE
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // start the DWT cycle counter
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+  }
+
+  // Each register access is a complete request, so there is nothing to claim
+  void beginTransaction() { }
+  void endTransaction() { }
+
+  void write(uint8_t reg, uint8_t value)
+  {
+    _tx[0] = reg | 0x80; // register write must have a 1 in bit 7 position
+    _tx[1] = value;
+    waitGap();
+    transfer(_tx, NULL, 2, 1);
+    endCommand(PAW3902_tSWW);
+  }
+
+  // Address and data go out as two requests with nCS held between them, so
+  // tSRAD can pass before the data byte is clocked
+  uint8_t read(uint8_t reg)
+  {
+    _tx[0] = reg & 0x7F; // register read must have a 0 in bit 7 position
+    waitGap();
+    transfer(_tx, NULL, 1, 0);
+    delayMicroseconds(PAW3902_tSRAD);
+    _tx[0] = 0x00;
+    transfer(_tx, _rx, 1, 1);
+    endCommand(PAW3902_tSRR);
+    return _rx[0];
+  }
+
+#if PAW3902_BURST_ASYNC
+  // The 0x16 command goes out on its own with nCS held, since tSRAD has to pass
+  // before the payload is clocked and one SPI17Y request can't pause mid-stream.
+  // The 12-byte payload is then queued as a single async request: 0xFF tx bytes
+  // keep MOSI high, rx lands straight in dataArray and the CPU sleeps until
+  // burst_cb() fires.
+  void readBurst(uint8_t * dataArray)
+  {
+    _tx[0] = 0x16;
+    waitGap();
+    transfer(_tx, NULL, 1, 0);
+    delayMicroseconds(PAW3902_tSRAD);
+
+    _burstReq.tx_data = _burstTx;
+    _burstReq.rx_data = dataArray;
+    _burstReq.width = SPI17Y_WIDTH_1;
+    _burstReq.ssel = 0;
+    _burstReq.ssel_pol = SPI17Y_POL_LOW;
+    _burstReq.bits = 8;
+    _burstReq.len = 12;
+    _burstReq.deass = 1; // release nCS after the last byte
+    _burstReq.callback = burst_cb;
+
+    burstBusy = 1;
+    burstError = E_NO_ERROR;
+    int error = SPI_MasterTransAsync(SPI0A, &_burstReq);
+    if(error == E_NO_ERROR)
+    {
+      __disable_irq();
+      while(burstBusy) { __WFI(); __enable_irq(); __disable_irq(); } // sleep until the transfer completes
+      __enable_irq();
+      if(burstError != E_NO_ERROR) {printf("SPI burst error %d\n", burstError);}
+    }
+    else
+    {
+      // Refused before anything was clocked, so nCS is still low after the
+      // command: read the payload with the blocking transfer instead
+      burstBusy = 0;
+      _burstReq.callback = NULL;
+      if((error = SPI_MasterTrans(SPI0A, &_burstReq)) != E_NO_ERROR) {printf("SPI error %d\n", error);}
+    }
+
+    GPIO_OutSet(&_cs);
+    endCommand(PAW3902_tSRR);
+    delayMicroseconds(1);
+  }
+#else
+  void readBurst(uint8_t * dataArray)
+  {
+    /* Setup MOSI output pin. */
+    gpio_cfg_t gpio_MOSI;
+    gpio_MOSI.port = 0;
+    gpio_MOSI.mask = MOSI;
+    gpio_MOSI.pad = GPIO_PAD_NONE;
+    gpio_MOSI.func = GPIO_FUNC_OUT;
+    GPIO_Config(&gpio_MOSI);
+
+    _tx[0] = 0x16;
+    waitGap();
+    transfer(_tx, NULL, 1, 0);
+    GPIO_OutSet(&gpio_MOSI); // hold MOSI high during burst read
+    delayMicroseconds(PAW3902_tSRAD);
+
+    for(uint8_t ii = 0; ii < 12; ii++)
+    {
+      transfer(_tx, _rx, 1, ii == 11);
+      dataArray[ii] = _rx[0];
+    }
+
+    endCommand(PAW3902_tSRR);
+    GPIO_OutClr(&gpio_MOSI); // return MOSI to LOW
+    delayMicroseconds(1);
+  }
+#endif
+
+  // Frame reads are plain register reads; the SPI17Y already drops nCS
+  // between them
+  void beginStream() { }
+  uint8_t streamRead(uint8_t reg) { return read(reg); }
+  void endStream() { }
+
+  bool settle(uint8_t ms) { delay(ms); return true; }
+
+  void delayMicros(uint32_t us) { delayMicroseconds(us); }
+  void delayMillis(uint32_t ms) { delay(ms); }
+  uint32_t micros() { return ::micros(); }
+  uint32_t ticks() { return DWT->CYCCNT; }
+  uint32_t ticksPerMicro() { return SystemCoreClock / 1000000; }
+
+private:
+  spi_req_t _req, _burstReq;
+  uint8_t _tx[2], _rx[2];
+  uint8_t _burstTx[12];
+  gpio_cfg_t _cs;
+  uint32_t _gapStart; // micros() at the end of the last command
+  uint8_t _gap;       // us the next command has to wait after it
+
+  void endCommand(uint8_t gap) { _gapStart = ::micros(); _gap = gap; }
+
+  void waitGap()
+  {
+    uint32_t remaining = paw3902GapRemaining(_gapStart, ::micros(), _gap);
+    if(remaining) delayMicroseconds(remaining);
+  }
+
+  void transfer(uint8_t * tx, uint8_t * rx, uint8_t len, uint8_t deass)
+  {
+    _req.tx_data = tx;
+    _req.rx_data = rx;
+    _req.width = SPI17Y_WIDTH_1;
+    _req.ssel = 0;
+    _req.ssel_pol = SPI17Y_POL_LOW;
+    _req.bits = 8;
+    _req.len = len;
+    _req.deass = deass; // 0 keeps nCS asserted for the next request
+    _req.callback = NULL;
+
+    GPIO_OutClr(&_cs); // already low for the second request of a read
+    int error = 0;
+    if((error = SPI_MasterTrans(SPI0A, &_req)) != 0) {printf("SPI error %d\n", error);}
+    if(deass) GPIO_OutSet(&_cs);
+  }
+};
+
+static PAW3902Core<PAW3902SPI17YBus> paw3902[PAW3902_SENSORS];
+static const uint32_t csPins[PAW3902_SENSORS] = PAW3902_CS_PINS;
+
+// C entry points for Main.c; the unindexed ones act on sensor 0
+
+void PAW3902begin()
+{
+  paw3902[0].bus().setChipSelect(csPins[0]);
+  paw3902[0].begin();
+}
+
+void setMode(uint8_t mode)
+{
+  paw3902[0].setMode(mode);
+}
+
+void switchMode(uint8_t mode)
+{
+  paw3902[0].switchMode(mode);
+}
+
+uint8_t getMode()
+{
+  return paw3902[0].getMode();
+}
+
+void initRegisters(uint8_t mode)
+{
+  paw3902[0].initRegisters(mode);
+}
+
+PAW3902SequenceStats getSequenceStats()
+{
+  return paw3902[0].getSequenceStats();
+}
+
+uint8_t checkID()
+{
+  uint8_t product_ID, revision_ID, inverse_product_ID;
+  bool ok = paw3902[0].checkID(&product_ID, &revision_ID, &inverse_product_ID);
+
+  printf("Product ID = 0x%x, should be 0x49 \n", product_ID);
+  printf("Revision ID = 0x0%x\n", revision_ID);
+  printf("Inverse Product ID = 0x%x, should be 0xB6\n", inverse_product_ID );
+  printf(" \n");
+
+  return ok;
+}
+
+void reset()
+{
+  paw3902[0].reset();
+}
+
+void shutdownPAW3902()
+{
+  paw3902[0].shutdown();
+}
+
+void wakePAW3902()
+{
+  paw3902[0].wake();
+}
+
+uint8_t PAW3902status()
+{
+  return paw3902[0].status();
+}
+
+void readMotionCount(int16_t *deltaX, int16_t *deltaY, uint8_t *SQUAL, uint16_t *Shutter)
+{
+  paw3902[0].readMotionCount(deltaX, deltaY, SQUAL, Shutter);
+}
+
+void readBurstMode(uint8_t * dataArray)
+{
+  paw3902[0].readBurstMode(dataArray);
+}
+
+void readSample(PAW3902Sample * sample)
+{
+  paw3902[0].readSample(sample);
+}
+
+void enterFrameCaptureMode()
+{
+  paw3902[0].enterFrameCaptureMode();
+}
+
+uint8_t captureFrame(uint8_t * frameArray)
+{
+  return paw3902[0].captureFrame(frameArray);
+}
+
+void exitFrameCaptureMode()
+{
+  paw3902[0].exitFrameCaptureMode();
+}
+
+uint8_t PAW3902beginSensor(uint8_t sensor)
+{
+  uint8_t product_ID, revision_ID, inverse_product_ID;
+  paw3902[sensor].bus().setChipSelect(csPins[sensor]);
+  paw3902[sensor].begin();
+  bool ok = paw3902[sensor].checkID(&product_ID, &revision_ID, &inverse_product_ID);
+  printf("Sensor %u: product ID = 0x%x, inverse 0x%x, %s\n", sensor, product_ID, inverse_product_ID, ok ? "ok" : "failed");
+  return ok;
+}
+
+void setModeSensor(uint8_t sensor, uint8_t mode)
+{
+  paw3902[sensor].setMode(mode);
+}
+
+void switchModeSensor(uint8_t sensor, uint8_t mode)
+{
+  paw3902[sensor].switchMode(mode);
+}
+
+uint8_t getModeSensor(uint8_t sensor)
+{
+  return paw3902[sensor].getMode();
+}
+
+void readSampleSensor(uint8_t sensor, PAW3902Sample * sample)
+{
+  paw3902[sensor].readSample(sample);
+}
+
+void shutdownSensor(uint8_t sensor)
+{
+  paw3902[sensor].shutdown();
+}
+
+void wakeSensor(uint8_t sensor)
+{
+  paw3902[sensor].wake();
+}
+
+#if PAW3902_PROFILE
+void printProfile()
+{
+  char line[120];
+  for(uint8_t op = 0; op < PAW3902_OPS; op++)
+  {
+    paw3902FormatProfile(line, sizeof(line), op, &paw3902[0].getProfile(op), paw3902[0].ticksPerMicro());
+    printf("%s\n", line);
+  }
+}
+#endif
@@ -42,36 +42,49 @@
 #include "tmr_utils.h"
 #include "spi.h"
 #include "math.h"
+#include "../PAW3902/PAW3902Tables.h" // register tables shared with the Arduino library
+#include "../PAW3902/PAW3902Sample.h"
+#include "../PAW3902/PAW3902Profile.h"
 
-#define bright        0
-#define lowlight      1
-#define superlowlight 2
 #define CSPIN         ((uint32_t)(1UL << 7)) // PIN_7
 #define MOSI          ((uint32_t)(1UL << 5)) // PIN_5
 
+#ifndef PAW3902_SENSORS
+#define PAW3902_SENSORS 1         // sensors sharing SPI0
+#define PAW3902_CS_PINS { CSPIN } // their port 0 chip selects, sensor 0 first
+#endif
+
   void PAW3902begin();
   uint8_t PAW3902status();
   void initRegisters(uint8_t mode);
   void readMotionCount(int16_t *deltaX, int16_t *deltaY, uint8_t *SQUAL, uint16_t *Shutter);
+  void readSample(PAW3902Sample * sample);
   uint8_t checkID();
   void setMode(uint8_t mode);
+  void switchMode(uint8_t mode);
   void reset();
   void shutdownPAW3902();
+  void wakePAW3902(); // reset and reload the current mode after shutdownPAW3902()
   uint8_t getMode();
   void enterFrameCaptureMode();
-  void captureFrame(uint8_t * frameArray);
+  uint8_t captureFrame(uint8_t * frameArray); // 0 if the sensor never flagged a pixel valid
   void exitFrameCaptureMode();
-  void initBright(void);
-  void initLowLight(void);
-  void initSuperLowLight(void);
+  void readBurstMode(uint8_t * dataArray);
+  PAW3902SequenceStats getSequenceStats();
+  // Several sensors on SPI0, by index; the calls above act on sensor 0
+  uint8_t PAW3902beginSensor(uint8_t sensor); // begin() and the ID check, 1 if it answered
+  void setModeSensor(uint8_t sensor, uint8_t mode);
+  void switchModeSensor(uint8_t sensor, uint8_t mode);
+  uint8_t getModeSensor(uint8_t sensor);
+  void readSampleSensor(uint8_t sensor, PAW3902Sample * sample);
+  void shutdownSensor(uint8_t sensor);
+  void wakeSensor(uint8_t sensor);
+#if PAW3902_PROFILE
+  void printProfile(); // one line per instrumented operation, DWT cycles shown as us
+#endif
   extern void delay(uint32_t time_ms);
   extern void delayMicroseconds(uint32_t time_us);
-  volatile uint8_t _mode;
-
-  extern void writeByte(uint8_t reg, uint8_t value);
-  extern void writeByteDelay(uint8_t reg, uint8_t value);
-  extern uint8_t readByte(uint8_t reg);
-  extern void readBurstMode(uint8_t * dataArray);
+  extern uint32_t micros(void);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,246 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __FLOWDEROTATION_H
+#define __FLOWDEROTATION_H
+
+#include <stdint.h>
+#include "PAW3902Sample.h"
+
+// Removes the flow a rotating airframe adds to deltaX/deltaY. Angular-rate
+// samples are pushed as they arrive (an IMU interrupt or the main loop) into
+// a single-producer/single-consumer ring like MotionRing; for each burst,
+// flowDerotate() integrates the rate over the interval since the previous
+// burst, taking it as linear between gyro samples and cutting the ends at
+// the interval, converts the angle to counts and subtracts it. The sample's
+// deltas are rewritten with translation-only counts, the fraction carried to
+// the next sample, so it can go straight on to MotionAccumulator or
+// VelocityEstimator.
+//
+// Fixed point throughout: rates are Q16 rad/s, the integral is kept in 64
+// bits, and the conversion to counts is a multiply by a reciprocal taken
+// once in flowDerotateInit(); a burst costs one 32-bit divide per interval
+// end that falls between gyro samples.
+//
+// The sensor integrates motion a little before the burst is read: the
+// interval is moved lagMicros earlier. Where the gyro samples do not reach
+// across the interval the nearest rate is held and the burst is counted in
+// uncovered. An interval longer than maxGapMicros restarts instead: a still
+// sensor raises no motion interrupt, and holding a rate across the pause
+// would subtract a rotation that never happened. The burst passes as is, is
+// counted in restarts, and the gyro samples before it are dropped.
+
+// The ring must hold the gyro samples of the longest burst interval plus
+// one: when it is full new samples are dropped (overruns) and the interval
+// ends on the last rate held. Only bursts move the tail, so while none
+// arrive the consumer has to call flowDerotateIdle() (from the loop or a
+// timer tick) to keep room for the samples after the pause.
+#ifndef DEROTATE_GYRO_SIZE
+#define DEROTATE_GYRO_SIZE 32 // must be a power of two
+#endif
+
+// Keeps the compiler from moving sample copies across the index update
+#define DEROTATE_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+typedef struct {
+  uint32_t timestamp; // us, same clock as the bursts
+  int32_t  rateX;     // Q16 rad/s about the gyro axes
+  int32_t  rateY;
+} GyroSample;
+
+typedef struct {
+  uint32_t microradPerCount; // flow angle per count, as in VelocityEstimator.h
+  uint32_t lagMicros;        // burst interval ends this long before its timestamp
+  int8_t   mapX[2];          // flow X from the angles about gyro X and Y, each -1, 0 or 1
+  int8_t   mapY[2];          // flow Y likewise
+  uint32_t maxGapMicros;     // a longer burst interval restarts, keep it within the ring's gyro samples
+} DerotateConfig;
+
+typedef struct {
+  DerotateConfig config;
+  uint32_t countScale;        // 2^32 / microradPerCount
+  GyroSample gyro[DEROTATE_GYRO_SIZE];
+  volatile uint16_t head;     // next slot to write, producer only
+  volatile uint16_t tail;     // oldest sample still needed, consumer only
+  volatile uint32_t overruns; // gyro samples dropped because the ring was full
+  uint32_t lastEnd;           // end of the previous burst interval
+  uint8_t  started;
+  int32_t  carryX, carryY;    // Q16 counts not yet reported
+  int32_t  rotX, rotY;        // Q16 counts removed from the last burst
+  uint32_t uncovered;         // bursts the gyro samples did not span
+  uint32_t restarts;          // bursts after a gap over maxGapMicros, passed as is
+} FlowDerotator;
+
+// Rotation about gyro Y moves the image along flow X and about gyro X along
+// flow Y for a sensor looking down with its axes on the gyro's; check signs
+// by rocking the board over a still surface, the output should stay near zero.
+// 30 ms is about three missed bursts, inside 32 gyro samples at 1 kHz.
+static const DerotateConfig derotateDefaults = {
+  2000, 2000, {0, 1}, {-1, 0}, 30000
+};
+
+// config NULL for derotateDefaults
+static inline void flowDerotateInit(FlowDerotator * d, const DerotateConfig * config)
+{
+  d->config = config ? *config : derotateDefaults;
+  d->countScale = (uint32_t)((((uint64_t)1 << 32) + d->config.microradPerCount / 2) / d->config.microradPerCount);
+  d->head = d->tail = 0;
+  d->overruns = 0;
+  d->started = 0;
+  d->carryX = d->carryY = d->rotX = d->rotY = 0;
+  d->uncovered = 0;
+  d->restarts = 0;
+}
+
+// Producer side; samples must come in time order
+static inline uint8_t gyroPush(FlowDerotator * d, const GyroSample * sample)
+{
+  uint16_t head = d->head;
+  if((uint16_t)(head - d->tail) >= DEROTATE_GYRO_SIZE)
+  {
+    d->overruns++;
+    return 0;
+  }
+  d->gyro[head & (DEROTATE_GYRO_SIZE - 1)] = *sample;
+  DEROTATE_BARRIER();
+  d->head = head + 1;
+  return 1;
+}
+
+// Consumer side: drops the gyro samples before t but the last, which starts
+// the next interval; that one goes too if it is over maxGapMicros old
+static inline void derotateDropBefore(FlowDerotator * d, uint32_t t)
+{
+  uint16_t head = d->head, ii = d->tail;
+  DEROTATE_BARRIER();
+  while(ii != head && (uint16_t)(ii + 1) != head && (int32_t)(d->gyro[(ii + 1) & (DEROTATE_GYRO_SIZE - 1)].timestamp - t) <= 0) ii++;
+  if(ii != head && (int32_t)(t - d->gyro[ii & (DEROTATE_GYRO_SIZE - 1)].timestamp) > (int32_t)d->config.maxGapMicros) ii++;
+  d->tail = ii;
+}
+
+// Call while no bursts arrive, with the current time. Once the pause is past
+// maxGapMicros the next burst restarts, so nothing before now is needed.
+static inline void flowDerotateIdle(FlowDerotator * d, uint32_t now)
+{
+  uint32_t end = now - d->config.lagMicros;
+  if(d->started && end - d->lastEnd > d->config.maxGapMicros) derotateDropBefore(d, end);
+}
+
+// Rate at t on the segment a..b, a->timestamp <= t <= b->timestamp
+static inline void derotateRateAt(const GyroSample * a, const GyroSample * b, uint32_t t, int32_t * rx, int32_t * ry)
+{
+  uint32_t span = b->timestamp - a->timestamp, into = t - a->timestamp;
+  if(!span || !into) { *rx = a->rateX; *ry = a->rateY; return; }
+  while(span > 0xFFFF) { span >>= 1; into >>= 1; } // keeps into << 16 in 32 bits
+  uint32_t frac = (into << 16) / span; // Q16
+  *rx = a->rateX + (int32_t)(((int64_t)(b->rateX - a->rateX) * frac) >> 16);
+  *ry = a->rateY + (int32_t)(((int64_t)(b->rateY - a->rateY) * frac) >> 16);
+}
+
+// Rate integral over start..end, Q16 rad/s * us; returns 1 if the gyro samples span it
+static inline uint8_t derotateIntegrate(FlowDerotator * d, uint32_t start, uint32_t end, int64_t * ax, int64_t * ay)
+{
+  uint16_t head = d->head, ii = d->tail;
+  DEROTATE_BARRIER();
+  *ax = *ay = 0;
+  if(ii == head) return 0;
+
+  const GyroSample * first = &d->gyro[ii & (DEROTATE_GYRO_SIZE - 1)];
+  uint8_t covered = 1;
+  if((int32_t)(first->timestamp - start) > 0) // gyro starts late: hold its first rate back to start
+  {
+    uint32_t held = (int32_t)(first->timestamp - end) < 0 ? first->timestamp - start : end - start;
+    *ax += (int64_t)first->rateX * held;
+    *ay += (int64_t)first->rateY * held;
+    covered = 0;
+  }
+
+  for(; (uint16_t)(ii + 1) != head; ii++)
+  {
+    const GyroSample * a = &d->gyro[ii & (DEROTATE_GYRO_SIZE - 1)], * b = &d->gyro[(ii + 1) & (DEROTATE_GYRO_SIZE - 1)];
+    if((int32_t)(b->timestamp - start) <= 0) { d->tail = ii + 1; continue; } // before the interval, no longer needed
+    if((int32_t)(a->timestamp - end) >= 0) break;
+
+    uint32_t lo = (int32_t)(a->timestamp - start) > 0 ? a->timestamp : start;
+    uint32_t hi = (int32_t)(b->timestamp - end) < 0 ? b->timestamp : end;
+    int32_t lx, ly, hx, hy;
+    if(lo == a->timestamp) { lx = a->rateX; ly = a->rateY; } else derotateRateAt(a, b, lo, &lx, &ly);
+    if(hi == b->timestamp) { hx = b->rateX; hy = b->rateY; } else derotateRateAt(a, b, hi, &hx, &hy);
+    *ax += ((int64_t)lx + hx) * (hi - lo) / 2;
+    *ay += ((int64_t)ly + hy) * (hi - lo) / 2;
+  }
+
+  const GyroSample * last = &d->gyro[ii & (DEROTATE_GYRO_SIZE - 1)];
+  if((int32_t)(last->timestamp - end) < 0) // gyro ends early: hold its last rate up to end
+  {
+    uint32_t from = (int32_t)(last->timestamp - start) > 0 ? last->timestamp : start;
+    *ax += (int64_t)last->rateX * (end - from);
+    *ay += (int64_t)last->rateY * (end - from);
+    covered = 0;
+  }
+  return covered;
+}
+
+// Q16 counts for a rate integral
+static inline int32_t derotateCounts(const FlowDerotator * d, int64_t integral)
+{
+  return (int32_t)((integral * d->countScale + ((int64_t)1 << 31)) >> 32);
+}
+
+static inline int16_t derotateEmit(int32_t * carry, int32_t translation)
+{
+  *carry += translation;
+  int32_t counts = (*carry + 0x8000) >> 16;
+  if(counts > INT16_MAX) counts = INT16_MAX;
+  if(counts < INT16_MIN) counts = INT16_MIN;
+  *carry -= counts * 65536;
+  return (int16_t)counts;
+}
+
+// Rewrites sample->deltaX/deltaY as translation only; returns 1 if the gyro
+// covered the whole interval. The first burst has no interval and passes as
+// is, as does one after a gap over maxGapMicros.
+static inline uint8_t flowDerotate(FlowDerotator * d, PAW3902Sample * sample)
+{
+  uint32_t end = sample->timestamp - d->config.lagMicros, start = d->lastEnd;
+  d->lastEnd = end;
+  if(!d->started || end - start > d->config.maxGapMicros)
+  {
+    if(d->started) d->restarts++;
+    d->started = 1;
+    d->rotX = d->rotY = 0;
+    derotateDropBefore(d, end);
+    return 0;
+  }
+
+  int64_t ax, ay;
+  uint8_t covered = derotateIntegrate(d, start, end, &ax, &ay);
+  if(!covered) d->uncovered++;
+  int32_t cx = derotateCounts(d, ax), cy = derotateCounts(d, ay);
+  d->rotX = d->config.mapX[0] * cx + d->config.mapX[1] * cy;
+  d->rotY = d->config.mapY[0] * cx + d->config.mapY[1] * cy;
+  sample->deltaX = derotateEmit(&d->carryX, (int32_t)sample->deltaX * 65536 - d->rotX);
+  sample->deltaY = derotateEmit(&d->carryY, (int32_t)sample->deltaY * 65536 - d->rotY);
+  return covered;
+}
+
+#endif //__FLOWDEROTATION_H
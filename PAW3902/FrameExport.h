@@ -0,0 +1,161 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __FRAMEEXPORT_H
+#define __FRAMEEXPORT_H
+
+#include <stdint.h>
+#include "Telemetry.h"
+
+// Binary 35 x 35 frame dumps over the telemetry framing. The payload is
+//
+//   type (TELEMETRY_FRAME), frame index (16 bit), mode, Shutter (16 bit),
+//   encoding, width, height, pixel data
+//
+// With FRAME_RAW the pixels follow row by row. With FRAME_DELTA_RLE each
+// pixel is first replaced by its difference from the pixel above (the top
+// row is kept as is), which turns the smooth, low-contrast images the
+// sensor sees into long runs of small values, and the result is PackBits
+// coded: a control byte c < 128 is followed by c + 1 literal bytes, c > 128
+// repeats the next byte 257 - c times.
+
+#define TELEMETRY_FRAME   0x02
+#define FRAME_HEADER_SIZE 9
+#define FRAME_WIDTH       35
+#define FRAME_HEIGHT      35
+#define FRAME_PIXELS      (FRAME_WIDTH * FRAME_HEIGHT)
+
+#define FRAME_RAW         0
+#define FRAME_DELTA_RLE   1
+
+// Largest payload either encoding can produce
+#define FRAME_MAX_PAYLOAD (FRAME_HEADER_SIZE + FRAME_PIXELS + (FRAME_PIXELS + 127) / 128)
+
+typedef struct {
+  uint16_t index;
+  uint16_t Shutter;
+  uint8_t  mode;
+  uint8_t  encoding;
+} FrameHeader;
+
+static inline uint8_t frameDelta(const uint8_t * frame, uint16_t ii)
+{
+  return ii < FRAME_WIDTH ? frame[ii] : (uint8_t)(frame[ii] - frame[ii - FRAME_WIDTH]);
+}
+
+// Returns the payload bytes sent, for comparing encodings
+static inline uint16_t frameExportSend(TelemetryEncoder * enc, const uint8_t * frame, const FrameHeader * header)
+{
+  static const uint8_t delimiter = 0x00;
+  uint16_t sent = FRAME_HEADER_SIZE, ii = 0;
+
+  enc->write(&delimiter, 1); // delimiter first, so text sent before the frame cannot corrupt it
+  telemetryBegin(enc, TELEMETRY_FRAME);
+  telemetryPut16(enc, header->index);
+  telemetryPut(enc, header->mode);
+  telemetryPut16(enc, header->Shutter);
+  telemetryPut(enc, header->encoding);
+  telemetryPut(enc, FRAME_WIDTH);
+  telemetryPut(enc, FRAME_HEIGHT);
+
+  if(header->encoding != FRAME_DELTA_RLE)
+  {
+    for(ii = 0; ii < FRAME_PIXELS; ii++) telemetryPut(enc, frame[ii]);
+    telemetryEnd(enc);
+    return sent + FRAME_PIXELS;
+  }
+
+  while(ii < FRAME_PIXELS)
+  {
+    uint8_t value = frameDelta(frame, ii);
+    uint16_t run = 1;
+    while(ii + run < FRAME_PIXELS && run < 128 && frameDelta(frame, ii + run) == value) run++;
+    if(run >= 3) // a run of two costs as much as two literals and would split the stretch
+    {
+      telemetryPut(enc, (uint8_t)(257 - run));
+      telemetryPut(enc, value);
+      sent += 2;
+      ii += run;
+      continue;
+    }
+
+    // Literal stretch, ends where a run of three or more starts
+    uint16_t literal = run;
+    while(ii + literal < FRAME_PIXELS && literal < 128)
+    {
+      uint8_t next = frameDelta(frame, ii + literal);
+      if(ii + literal + 2 < FRAME_PIXELS && next == frameDelta(frame, ii + literal + 1) && next == frameDelta(frame, ii + literal + 2)) break;
+      literal++;
+    }
+    telemetryPut(enc, (uint8_t)(literal - 1));
+    for(uint16_t jj = 0; jj < literal; jj++) telemetryPut(enc, frameDelta(frame, ii + jj));
+    sent += literal + 1;
+    ii += literal;
+  }
+  telemetryEnd(enc);
+  return sent;
+}
+
+// Unpack a decoded TELEMETRY_FRAME payload into frame, 0 if it is malformed
+static inline uint8_t frameExportDecode(const uint8_t * payload, uint16_t length, FrameHeader * header, uint8_t * frame)
+{
+  if(length < FRAME_HEADER_SIZE || payload[0] != TELEMETRY_FRAME) return 0;
+  if(payload[7] != FRAME_WIDTH || payload[8] != FRAME_HEIGHT) return 0;
+  header->index    = telemetryGet16(payload + 1);
+  header->mode     = payload[3];
+  header->Shutter  = telemetryGet16(payload + 4);
+  header->encoding = payload[6];
+
+  const uint8_t * p = payload + FRAME_HEADER_SIZE, * end = payload + length;
+  uint16_t ii = 0;
+
+  if(header->encoding == FRAME_RAW)
+  {
+    if(end - p != FRAME_PIXELS) return 0;
+    for(ii = 0; ii < FRAME_PIXELS; ii++) frame[ii] = p[ii];
+    return 1;
+  }
+  if(header->encoding != FRAME_DELTA_RLE) return 0;
+
+  while(p < end)
+  {
+    uint8_t control = *p++;
+    if(control < 128)
+    {
+      if(end - p < control + 1 || ii + control + 1 > FRAME_PIXELS) return 0;
+      for(uint16_t jj = 0; jj <= control; jj++) frame[ii++] = *p++;
+    }
+    else if(control > 128)
+    {
+      uint16_t run = 257 - control;
+      if(p == end || ii + run > FRAME_PIXELS) return 0;
+      for(uint16_t jj = 0; jj < run; jj++) frame[ii++] = *p;
+      p++;
+    }
+  }
+  if(ii != FRAME_PIXELS) return 0;
+
+  for(ii = FRAME_WIDTH; ii < FRAME_PIXELS; ii++) frame[ii] += frame[ii - FRAME_WIDTH]; // undo the row delta
+  return 1;
+}
+
+#endif //__FRAMEEXPORT_H
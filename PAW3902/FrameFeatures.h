@@ -0,0 +1,138 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __FRAMEFEATURES_H
+#define __FRAMEFEATURES_H
+
+#include <stdint.h>
+#include "FrameExport.h"
+
+// FAST-9 corners with non-maximum suppression on a 35 x 35 frame from
+// captureFrame(), read where it lies: nothing is copied and no score map is
+// kept, a corner's neighbours are scored again when it is checked against
+// them.
+//
+// A pixel is a corner when 9 contiguous pixels of the 16 on the radius 3
+// circle around it are all brighter than it by more than threshold, or all
+// darker. Its score is the summed excess over threshold of the ring pixels
+// on that side, at least 9 and at most 16 * 255. A corner is kept if none of
+// its 8 neighbours scores higher; of equal neighbours the first in raster
+// order is kept. Centres run from FEATURE_FIRST to FEATURE_LAST on both axes.
+//
+// The work is bounded whatever the frame holds: scoring a pixel reads at
+// most 16 ring pixels, a corner costs 8 more scorings, so a frame is at most
+// 29 * 29 * 9 scorings, and the stack use is a few words. Most pixels fail
+// on the four compass points and cost 4 reads.
+
+#define FEATURE_RADIUS 3
+#define FEATURE_ARC    9
+#define FEATURE_FIRST  FEATURE_RADIUS                     // first centre row and column
+#define FEATURE_LAST   (FRAME_WIDTH - 1 - FEATURE_RADIUS) // last
+
+typedef struct {
+  uint8_t  x, y; // column, row
+  uint16_t score;
+} FrameFeature;
+
+// Ring offsets, clockwise from straight up
+static const int16_t featureRing[16] = {
+  -3 * FRAME_WIDTH,     -3 * FRAME_WIDTH + 1, -2 * FRAME_WIDTH + 2, -FRAME_WIDTH + 3,
+   3,                    FRAME_WIDTH + 3,      2 * FRAME_WIDTH + 2,  3 * FRAME_WIDTH + 1,
+   3 * FRAME_WIDTH,      3 * FRAME_WIDTH - 1,  2 * FRAME_WIDTH - 2,  FRAME_WIDTH - 3,
+  -3,                   -FRAME_WIDTH - 3,     -2 * FRAME_WIDTH - 2, -3 * FRAME_WIDTH - 1
+};
+
+// Nonzero if the 16 bit ring mask has FEATURE_ARC contiguous bits set, wrapping around
+static inline uint8_t featureArc(uint16_t mask)
+{
+  uint32_t ring = mask | ((uint32_t)mask << 16), run = ring;
+  for(uint8_t ii = 1; ii < FEATURE_ARC; ii++) run &= ring >> ii;
+  return (run & 0xFFFF) != 0;
+}
+
+// Corner score of the pixel at p, 0 if it is not a corner
+static inline uint16_t featureScore(const uint8_t * p, uint8_t threshold)
+{
+  uint8_t c = p[0];
+  uint8_t hi = c > 255 - threshold ? 255 : c + threshold, lo = c < threshold ? 0 : c - threshold;
+
+  // An arc of 9 covers two neighbouring compass points
+  uint8_t above = 0, below = 0;
+  for(uint8_t ii = 0; ii < 16; ii += 4)
+  {
+    uint8_t v = p[featureRing[ii]];
+    above = (uint8_t)(above << 1 | (v > hi));
+    below = (uint8_t)(below << 1 | (v < lo));
+  }
+  if(!(above & (above << 1 | above >> 3)) && !(below & (below << 1 | below >> 3))) return 0;
+
+  uint16_t aboveMask = 0, belowMask = 0, aboveSum = 0, belowSum = 0;
+  for(uint8_t ii = 0; ii < 16; ii++)
+  {
+    uint8_t v = p[featureRing[ii]];
+    if(v > hi) { aboveMask |= (uint16_t)1 << ii; aboveSum += v - hi; }
+    else if(v < lo) { belowMask |= (uint16_t)1 << ii; belowSum += lo - v; }
+  }
+  if(featureArc(aboveMask)) return aboveSum;
+  if(featureArc(belowMask)) return belowSum;
+  return 0;
+}
+
+// As featureScore(), 0 outside the centres
+static inline uint16_t featureScoreAt(const uint8_t * frame, uint8_t x, uint8_t y, uint8_t threshold)
+{
+  if(x < FEATURE_FIRST || x > FEATURE_LAST || y < FEATURE_FIRST || y > FEATURE_LAST) return 0;
+  return featureScore(&frame[y * FRAME_WIDTH + x], threshold);
+}
+
+// Nonzero if the corner at (x, y) survives non-maximum suppression
+static inline uint8_t featurePeak(const uint8_t * frame, uint8_t x, uint8_t y, uint8_t threshold, uint16_t score)
+{
+  for(int8_t dy = -1; dy <= 1; dy++)
+    for(int8_t dx = -1; dx <= 1; dx++)
+    {
+      if(!dx && !dy) continue;
+      uint16_t other = featureScoreAt(frame, (uint8_t)(x + dx), (uint8_t)(y + dy), threshold);
+      if(other > score || (other == score && (dy < 0 || (dy == 0 && dx < 0)))) return 0;
+    }
+  return 1;
+}
+
+// Corners of frame in raster order, at most max of them; returns how many
+// were stored, so max means there may be more (raise threshold)
+static inline uint16_t frameFeatures(const uint8_t * frame, uint8_t threshold, FrameFeature * features, uint16_t max)
+{
+  uint16_t count = 0;
+  for(uint8_t y = FEATURE_FIRST; y <= FEATURE_LAST && count < max; y++)
+    for(uint8_t x = FEATURE_FIRST; x <= FEATURE_LAST && count < max; x++)
+    {
+      uint16_t score = featureScore(&frame[y * FRAME_WIDTH + x], threshold);
+      if(!score || !featurePeak(frame, x, y, threshold, score)) continue;
+      features[count].x = x;
+      features[count].y = y;
+      features[count].score = score;
+      count++;
+    }
+  return count;
+}
+
+#endif //__FRAMEFEATURES_H
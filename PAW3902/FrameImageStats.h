@@ -0,0 +1,97 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __FRAMEIMAGESTATS_H
+#define __FRAMEIMAGESTATS_H
+
+#include <stdint.h>
+
+// Brightness, contrast and focus figures for a 35 x 35 frame, gathered one
+// pixel at a time as captureFrame()/serviceFrame() stores them (pass a
+// FrameImageStats to startFrame()), so nothing walks the frame afterwards.
+// Pixels arrive in array order, so the left and upper neighbours a gradient
+// needs are already in the frame.
+//
+// sharpness is the gradient energy: squared differences to the left and
+// upper neighbours, summed. It grows with focus and contrast, so compare it
+// between frames of the same scene.
+
+#ifndef FRAME_HISTOGRAM_BINS
+#define FRAME_HISTOGRAM_BINS 32 // each 256 / FRAME_HISTOGRAM_BINS levels wide
+#endif
+#define FRAME_IMAGE_WIDTH    35
+
+typedef struct {
+  uint16_t histogram[FRAME_HISTOGRAM_BINS];
+  uint16_t pixels;     // counted so far; below 1225 if the capture stopped early
+  uint8_t  min, max;
+  uint8_t  mean;       // rounded, set by frameImageEnd()
+  uint16_t variance;   // levels squared, set by frameImageEnd()
+  uint32_t sum, sumSquares;
+  uint32_t sharpness;
+  uint8_t  column;     // of the next pixel
+} FrameImageStats;
+
+static inline void frameImageBegin(FrameImageStats * stats)
+{
+  for(uint8_t ii = 0; ii < FRAME_HISTOGRAM_BINS; ii++) stats->histogram[ii] = 0;
+  stats->pixels = 0;
+  stats->min = 255;
+  stats->max = 0;
+  stats->mean = 0;
+  stats->variance = 0;
+  stats->sum = stats->sumSquares = stats->sharpness = 0;
+  stats->column = 0;
+}
+
+// frame[index] has just been stored; index counts up from 0 without gaps
+static inline void frameImagePixel(FrameImageStats * stats, const uint8_t * frame, uint16_t index)
+{
+  uint8_t value = frame[index];
+  stats->histogram[(uint16_t)value * FRAME_HISTOGRAM_BINS >> 8]++;
+  if(value < stats->min) stats->min = value;
+  if(value > stats->max) stats->max = value;
+  stats->sum += value;
+  stats->sumSquares += (uint16_t)value * value;
+  if(stats->column) { int16_t d = value - frame[index - 1]; stats->sharpness += (uint16_t)(d * d); }
+  if(index >= FRAME_IMAGE_WIDTH) { int16_t d = value - frame[index - FRAME_IMAGE_WIDTH]; stats->sharpness += (uint16_t)(d * d); }
+  if(++stats->column == FRAME_IMAGE_WIDTH) stats->column = 0;
+  stats->pixels++;
+}
+
+static inline void frameImageEnd(FrameImageStats * stats)
+{
+  if(!stats->pixels) return;
+  uint32_t n = stats->pixels;
+  stats->mean = (uint8_t)((stats->sum + n / 2) / n);
+  stats->variance = (uint16_t)(((uint64_t)stats->sumSquares * n - (uint64_t)stats->sum * stats->sum) / ((uint64_t)n * n));
+}
+
+// The same figures from a frame already in memory
+static inline void frameImageStats(const uint8_t * frame, uint16_t pixels, FrameImageStats * stats)
+{
+  frameImageBegin(stats);
+  for(uint16_t ii = 0; ii < pixels; ii++) frameImagePixel(stats, frame, ii);
+  frameImageEnd(stats);
+}
+
+#endif //__FRAMEIMAGESTATS_H
@@ -0,0 +1,137 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __LIGHTMODECONTROLLER_H
+#define __LIGHTMODECONTROLLER_H
+
+#include <stdint.h>
+#include "PAW3902Sample.h"
+
+// Automatic light mode selection from decoded burst samples. Each transition
+// fires once its shutter (and RawDataSum) condition has held for dwell
+// consecutive samples; leaving superlowlight on a very short shutter is
+// immediate. State is a handful of counters, so the same sample trace always
+// gives the same decisions on the host and on the MCU. Modes are indexed
+// bright = 0, lowlight = 1, superlowlight = 2 as in PAW3902.h.
+//
+// lightModeRate() grades each sample for the filters downstream instead of
+// only gating it: confidence is the product of three ramps on the mode's own
+// thresholds, each 0..255,
+//
+//   SQUAL       0 at minSQUAL / 2, full at fullSQUAL
+//   Shutter     full below gateShutter / 2, halved at gateShutter and above
+//   RawDataSum  half at 0, full at fullRawDataSum
+//
+// so a gated sample still carries what quality it has, and a sample that
+// passes the gate on a short shutter with few features is still marked down.
+// valid is the gate itself, unchanged.
+
+#define LIGHTMODE_HOLD 0xFF // lightModeUpdate(): stay in the current mode
+
+typedef struct {
+  uint16_t toBrightShutter;      // lowlight -> bright below this shutter
+  uint16_t toLowlightShutter;    // superlowlight -> lowlight below this shutter
+  uint16_t dropShutter;          // superlowlight -> lowlight at once below this shutter
+  uint16_t darkerShutter;        // bright -> lowlight, lowlight -> superlowlight at or above this shutter
+  uint8_t  darkerRawDataSum[2];  // ... and below this RawDataSum, {bright, lowlight}
+  uint8_t  dwell;                // consecutive samples a condition must hold
+  uint8_t  minSQUAL[3];          // motion is unreliable below this SQUAL ...
+  uint16_t gateShutter[3];       // ... when shutter is also at or above this
+  uint8_t  fullSQUAL[3];         // confidence is full from this SQUAL up
+  uint8_t  fullRawDataSum;       // ... and this RawDataSum
+} LightModeConfig;
+
+typedef struct {
+  LightModeConfig config;
+  uint8_t count[4]; // dwell counters: to bright, superlowlight to lowlight, bright to lowlight, to superlowlight
+} LightModeController;
+
+// Thresholds the sketches have always used
+static const LightModeConfig lightModeDefaults = {
+  0x0BB8, 0x03E8, 0x01F4, 0x1E1F, {0x3C, 0x5A}, 10,
+  {25, 70, 85}, {0x1FF0, 0x1FF0, 0x0BC0},
+  {100, 110, 120}, 0x3C
+};
+
+static inline void lightModeInit(LightModeController * ctrl, const LightModeConfig * config)
+{
+  ctrl->config = config ? *config : lightModeDefaults;
+  ctrl->count[0] = ctrl->count[1] = ctrl->count[2] = ctrl->count[3] = 0;
+}
+
+// Count consecutive samples meeting a condition, 1 once dwell is reached
+static inline uint8_t lightModeDwell(LightModeController * ctrl, uint8_t ii, uint8_t condition)
+{
+  if(!condition) { ctrl->count[ii] = 0; return 0; }
+  if(++ctrl->count[ii] < ctrl->config.dwell) return 0;
+  ctrl->count[ii] = 0; // rearm, samples already queued still carry the old mode
+  return 1;
+}
+
+// Mode to switch to after this sample, or LIGHTMODE_HOLD
+static inline uint8_t lightModeUpdate(LightModeController * ctrl, const PAW3902Sample * sample)
+{
+  const LightModeConfig * c = &ctrl->config;
+  uint8_t mode = sample->mode;
+  uint16_t shutter = sample->Shutter;
+  uint8_t decision = LIGHTMODE_HOLD;
+
+  if(lightModeDwell(ctrl, 0, mode == 1 && shutter < c->toBrightShutter)) decision = 0;
+  if(lightModeDwell(ctrl, 1, mode == 2 && shutter < c->toLowlightShutter)) decision = 1;
+  if(lightModeDwell(ctrl, 2, mode == 0 && shutter >= c->darkerShutter && sample->RawDataSum < c->darkerRawDataSum[0])) decision = 1;
+  if(lightModeDwell(ctrl, 3, mode == 1 && shutter >= c->darkerShutter && sample->RawDataSum < c->darkerRawDataSum[1])) decision = 2;
+  if(mode == 2 && shutter < c->dropShutter) decision = 1;
+
+  return decision;
+}
+
+// 0 when the sample's motion should not be reported in its mode
+static inline uint8_t lightModeValid(const LightModeController * ctrl, const PAW3902Sample * sample)
+{
+  uint8_t mode = sample->mode;
+  if(mode > 2) return 1;
+  return !(sample->SQUAL < ctrl->config.minSQUAL[mode] && sample->Shutter >= ctrl->config.gateShutter[mode]);
+}
+
+// 0 at lo and below, 255 at hi and above, linear between
+static inline uint8_t lightModeRamp(uint16_t x, uint16_t lo, uint16_t hi)
+{
+  if(x <= lo) return 0;
+  if(x >= hi) return 255;
+  return (uint8_t)((uint32_t)(x - lo) * 255 / (hi - lo));
+}
+
+// Fill in sample->confidence and sample->valid; samples in an unknown mode stay unrated
+static inline void lightModeRate(const LightModeController * ctrl, PAW3902Sample * sample)
+{
+  const LightModeConfig * c = &ctrl->config;
+  uint8_t mode = sample->mode;
+  sample->valid = lightModeValid(ctrl, sample);
+  if(mode > 2) { sample->confidence = 255; return; }
+
+  uint32_t squal = lightModeRamp(sample->SQUAL, c->minSQUAL[mode] >> 1, c->fullSQUAL[mode]);
+  uint32_t light = 255 - (lightModeRamp(sample->Shutter, c->gateShutter[mode] >> 1, c->gateShutter[mode]) >> 1);
+  uint32_t raw = 128 + (lightModeRamp(sample->RawDataSum, 0, c->fullRawDataSum) >> 1);
+  sample->confidence = (uint8_t)((squal * light * raw + 32512) / 65025); // rounded, 255 * 255 * 255 stays 255
+}
+
+#endif //__LIGHTMODECONTROLLER_H
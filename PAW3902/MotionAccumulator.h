@@ -0,0 +1,81 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __MOTIONACCUMULATOR_H
+#define __MOTIONACCUMULATOR_H
+
+#include <stdint.h>
+#include <string.h>
+#include "PAW3902Sample.h"
+
+// Sums every burst into 32-bit X/Y totals so a slow consumer loses no
+// displacement. The producer (motion interrupt) adds into one half while the
+// consumer takes the other: motionTake() flips the active half, and since the
+// producer can preempt the consumer but not the other way round, the half it
+// just left is quiescent and can be copied and cleared without masking
+// interrupts.
+
+typedef struct {
+  int32_t  deltaX;         // summed counts
+  int32_t  deltaY;
+  uint32_t samples;
+  uint8_t  minSQUAL;
+  uint8_t  maxSQUAL;
+  uint32_t firstTimestamp; // us, first and last sample summed
+  uint32_t lastTimestamp;
+} MotionTotals;
+
+typedef struct {
+  MotionTotals totals[2];
+  volatile uint8_t active; // half the producer adds into
+} MotionAccumulator;
+
+static inline void motionAccumulate(MotionAccumulator * acc, const PAW3902Sample * sample)
+{
+  MotionTotals * t = &acc->totals[acc->active];
+  if(t->samples == 0)
+  {
+    t->minSQUAL = t->maxSQUAL = sample->SQUAL;
+    t->firstTimestamp = sample->timestamp;
+  }
+  else
+  {
+    if(sample->SQUAL < t->minSQUAL) t->minSQUAL = sample->SQUAL;
+    if(sample->SQUAL > t->maxSQUAL) t->maxSQUAL = sample->SQUAL;
+  }
+  t->deltaX += sample->deltaX;
+  t->deltaY += sample->deltaY;
+  t->lastTimestamp = sample->timestamp;
+  t->samples++;
+}
+
+// Read and clear everything accumulated since the last call
+static inline void motionTake(MotionAccumulator * acc, MotionTotals * totals)
+{
+  uint8_t taken = acc->active;
+  acc->active = taken ^ 1;
+  __asm__ __volatile__("" ::: "memory");
+  *totals = acc->totals[taken];
+  memset(&acc->totals[taken], 0, sizeof(MotionTotals));
+}
+
+#endif //__MOTIONACCUMULATOR_H
@@ -0,0 +1,78 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __MOTIONRING_H
+#define __MOTIONRING_H
+
+#include <stdint.h>
+#include "PAW3902Sample.h"
+
+// Single-producer/single-consumer ring of motion samples. The motion interrupt
+// pushes, the main loop pops; head is only written by the producer and tail
+// only by the consumer, so neither side needs to mask interrupts. When the
+// ring is full the new sample is dropped and counted in overruns.
+
+#ifndef MOTION_RING_SIZE
+#define MOTION_RING_SIZE 64 // must be a power of two
+#endif
+
+// Keeps the compiler from moving sample copies across the index update
+#define MOTION_RING_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+typedef struct {
+  PAW3902Sample samples[MOTION_RING_SIZE];
+  volatile uint16_t head;     // next slot to write, producer only
+  volatile uint16_t tail;     // next slot to read, consumer only
+  volatile uint32_t overruns; // samples dropped because the ring was full
+} MotionRing;
+
+static inline uint8_t motionRingPush(MotionRing * ring, const PAW3902Sample * sample)
+{
+  uint16_t head = ring->head;
+  if((uint16_t)(head - ring->tail) >= MOTION_RING_SIZE)
+  {
+    ring->overruns++;
+    return 0;
+  }
+  ring->samples[head & (MOTION_RING_SIZE - 1)] = *sample;
+  MOTION_RING_BARRIER();
+  ring->head = head + 1;
+  return 1;
+}
+
+static inline uint8_t motionRingPop(MotionRing * ring, PAW3902Sample * sample)
+{
+  uint16_t tail = ring->tail;
+  if(tail == ring->head) return 0;
+  MOTION_RING_BARRIER();
+  *sample = ring->samples[tail & (MOTION_RING_SIZE - 1)];
+  MOTION_RING_BARRIER();
+  ring->tail = tail + 1;
+  return 1;
+}
+
+static inline uint16_t motionRingCount(const MotionRing * ring)
+{
+  return (uint16_t)(ring->head - ring->tail);
+}
+
+#endif //__MOTIONRING_H
@@ -24,39 +24,146 @@
 #define __PAW3902_H
 
 #include "Arduino.h"
+#include <SPI.h>
 
 #include <stdint.h>
+#include "PAW3902Core.h"
 
-#define bright        0
-#define lowlight      1
-#define superlowlight 2
-
-class PAW3902 {
+// Arduino SPI transport for PAW3902Core. Everything it keeps, gaps included,
+// is per sensor, so instances on the same port only share the SPIClass.
+class PAW3902ArduinoBus {
 public:
-  PAW3902(uint8_t cspin);
-  boolean begin(void);
-  uint8_t status();
-  void initRegisters(uint8_t mode);
-  void readMotionCount(int16_t *deltaX, int16_t *deltaY, uint8_t *SQUAL, uint16_t *Shutter);
-  void readBurstMode(uint8_t * dataArray); 
-  boolean checkID();
-  void setMode(uint8_t mode);
-  void reset();
-  void shutdown();
-  uint8_t getMode();
-  void enterFrameCaptureMode();
-  uint8_t captureFrame(uint8_t * frameArray);
-  void exitFrameCaptureMode();
+  PAW3902ArduinoBus(uint8_t cspin, SPIClass & spi = SPI, uint8_t mosi = MOSI)
+    : _spi(&spi), _cs(cspin), _mosi(mosi), _gapStart(0), _gap(0) { }
+
+  void begin()
+  {
+    _spi->beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE3)); // 2 MHz max SPI clock frequency
+    digitalWrite(_cs, HIGH);
+    delay(1);
+    digitalWrite(_cs, LOW);
+    delay(1);
+    digitalWrite(_cs, HIGH);
+    delay(1);
+    _spi->endTransaction();
+  }
+
+  void beginTransaction() { _spi->beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE3)); }
+  void endTransaction()   { _spi->endTransaction(); }
+
+  void write(uint8_t reg, uint8_t value)
+  {
+    digitalWrite(_cs, LOW);
+    waitGap();
+    _spi->transfer(reg | 0x80);
+    _spi->transfer(value);
+    endCommand(PAW3902_tSWW);
+    delayMicroseconds(1);
+    digitalWrite(_cs, HIGH);
+  }
+
+  uint8_t read(uint8_t reg)
+  {
+    digitalWrite(_cs, LOW);
+    delayMicroseconds(1);
+    waitGap();
+    _spi->transfer(reg & 0x7F);
+    delayMicroseconds(PAW3902_tSRAD);
+    uint8_t temp = _spi->transfer(0);
+    endCommand(PAW3902_tSRR);
+    delayMicroseconds(1);
+    digitalWrite(_cs, HIGH);
+    return temp;
+  }
+
+  void readBurst(uint8_t * dataArray)
+  {
+    _spi->beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE3));
+    digitalWrite(_cs, LOW);
+    delayMicroseconds(1);
+    waitGap();
+
+    _spi->transfer(0x16); // start burst mode
+    digitalWrite(_mosi, HIGH); // hold MOSI high during burst read
+    delayMicroseconds(PAW3902_tSRAD);
+
+    for(uint8_t ii = 0; ii < 12; ii++)
+    {
+      dataArray[ii] = _spi->transfer(0);
+    }
+    endCommand(PAW3902_tSRR);
+    digitalWrite(_mosi, LOW); // return MOSI to LOW
+    digitalWrite(_cs, HIGH);
+    delayMicroseconds(1);
+
+    _spi->endTransaction();
+  }
+
+  // Frame reads stream with chip select held low for the whole slice
+  void beginStream()
+  {
+    _spi->beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE3));
+    digitalWrite(_cs, LOW);
+    delayMicroseconds(1);
+  }
+
+  uint8_t streamRead(uint8_t reg)
+  {
+    waitGap();
+    _spi->transfer(reg);
+    delayMicroseconds(PAW3902_tSRAD);
+    uint8_t temp = _spi->transfer(0);
+    endCommand(PAW3902_tSRR);
+    return temp;
+  }
+
+  void endStream()
+  {
+    digitalWrite(_cs, HIGH);
+    _spi->endTransaction();
+  }
+
+  // Other users of the bus get it back for the wait. That takes down the
+  // SPI.usingInterrupt() mask too, so an interrupt that reads bursts must be
+  // held off by the caller until the mode change is over (acquire in PAW3902.ino)
+  bool settle(uint8_t ms)
+  {
+    _spi->endTransaction();
+    delay(ms);
+    _spi->beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE3));
+    return true;
+  }
+
+  void delayMicros(uint32_t us) { delayMicroseconds(us); }
+  void delayMillis(uint32_t ms) { delay(ms); }
+  uint32_t micros() { return ::micros(); }
+  uint32_t ticks() { return ::micros(); }
+  uint32_t ticksPerMicro() { return 1; }
 
 private:
-  uint8_t _cs, _mode;
-  void writeByte(uint8_t reg, uint8_t value);
-  void writeByteDelay(uint8_t reg, uint8_t value);
-  uint8_t readByte(uint8_t reg);
-  void initBright(void);
-  void initLowLight(void);
-  void initSuperLowLight(void);
+  SPIClass * _spi;
+  uint8_t _cs, _mosi;
+  uint32_t _gapStart; // micros() at the end of the last command
+  uint8_t _gap;       // us the next command has to wait after it
+
+  void endCommand(uint8_t gap) { _gapStart = ::micros(); _gap = gap; }
+
+  void waitGap()
+  {
+    uint32_t remaining = paw3902GapRemaining(_gapStart, ::micros(), _gap);
+    if(remaining) delayMicroseconds(remaining);
+  }
 };
 
-#endif //__PAW3902_H
+class PAW3902 : public PAW3902Core<PAW3902ArduinoBus> {
+public:
+  // Several sensors can share one SPI port, each with its own chip select
+  PAW3902(uint8_t cspin, SPIClass & spi = SPI, uint8_t mosi = MOSI)
+    : PAW3902Core<PAW3902ArduinoBus>(PAW3902ArduinoBus(cspin, spi, mosi)) { }
+  boolean checkID(); // also prints the IDs on Serial
+#if PAW3902_PROFILE
+  void printProfile(); // one line per instrumented operation on Serial
+#endif
+};
 
+#endif //__PAW3902_H
@@ -14,6 +14,15 @@
   */
 #include <SPI.h>
 #include "PAW3902.h"
+#include "MotionRing.h"
+#include "MotionAccumulator.h"
+#include "LightModeController.h"
+#include "Telemetry.h"
+#include "FrameExport.h"
+#include "FrameFeatures.h"
+#include "VelocityEstimator.h"
+#include "PowerManager.h"
+#include "TaskScheduler.h"
 
 // Pin definitions
 #define myLed  26  // blue led on Dragonfly
@@ -23,12 +32,63 @@
 #define RST    21  // PAM3902 reset
 #define MOT    30  // use as data ready interrupt
 
+#define ISR_ACQUISITION 1 // 1 = read each burst in the motion interrupt, 0 = flag it and read in motionTask()
+#define TELEMETRY_BINARY 0 // 1 = COBS framed binary samples (host/telemetry_decode), 0 = text
+#define FRAME_EXPORT     0 // 0 = decimal text, 1 = binary raw, 2 = binary row delta + RLE (telemetry_decode writes PGM)
+#define FRAME_CORNERS    16 // corners listed after each text frame, 0 = none (FrameFeatures.h)
+#define CORNER_THRESHOLD 12 // brightness step a corner needs around it
+#define SENSOR_HEIGHT_MM 0  // sensor height above the ground for velocity output (VelocityEstimator.h), 0 = off
+#define POWER_IDLE_MS    0  // shut the sensor down after this long without motion (PowerManager.h), 0 = always on
+#define POWER_WAKE_MS    500 // ... and wake it this often to look for motion
+
+// Task periods and deadlines in us (TaskScheduler.h). The rings hold half a
+// second of samples at the fastest frame rate, so a late motion or output
+// task adds latency before it loses anything.
+#define MOTION_TASK_US      2000    // rate and queue samples
+#define MOTION_DEADLINE_US  40000   // ... within five bright frames; a light mode switch takes 20 ms
+#define MODE_TASK_US        100000  // light mode switches and sensor power
+#define OUTPUT_TASK_US      10000   // telemetry or text for every sample
+#define OUTPUT_DEADLINE_US  50000
+#define FRAME_TASK_US       10000   // one frame capture slice (FRAME_SLICE_US) per run
+#define FRAME_DEADLINE_US   50000
+#define REPORT_TASK_US      1000000 // totals and task timing
+
 uint8_t mode = bright; // mode choices are bright, lowlight (default), superlowlight
 int16_t deltaX, deltaY, Shutter;
-bool motionDetect = false, alarmFlag = false;
+volatile bool motionDetect = false; // motion interrupt not yet read: by motionTask(), or by resumeAcquisition() with ISR_ACQUISITION
+bool alarmFlag = false;
 uint8_t status;
-uint8_t frameArray[1225], dataArray[12], SQUAL, RawDataSum = 0;
-uint8_t count0 = 0, count1 = 0, count2 = 0, count3 = 0, iterations = 0;
+uint8_t frameArray[1225], SQUAL, RawDataSum = 0;
+uint8_t newMode, pendingMode = LIGHTMODE_HOLD, iterations = 0;
+bool moved = false; // samples since the last mode task pass
+uint16_t frameIndex = 0; // frames captured since reset, gaps in exported indices are timeouts
+uint8_t frameStep = 0, frameCount = 0, frameState; // frameStep 0 = navigating, 1 = waiting for camera to settle, 2 = capturing
+uint32_t frameTimer = 0;
+#if FRAME_CORNERS
+FrameFeature corners[FRAME_CORNERS];
+#endif
+FrameImageStats imageStats; // histogram, brightness, contrast and sharpness, built while the frame is captured
+
+MotionRing motionRing; // decoded samples from the motion interrupt, drained by motionTask()
+MotionRing outputRing; // rated samples waiting for outputTask()
+LightModeController lightMode; // shutter/RawDataSum hysteresis, see LightModeController.h
+MotionAccumulator motionAccumulator; // every sample summed between reports, see motionTake()
+PAW3902Sample sample;
+MotionTotals totals;
+#if SENSOR_HEIGHT_MM
+VelocityEstimator velocity; // ground speed from every sample, low SQUAL weighted down
+#endif
+#if POWER_IDLE_MS
+PowerManager power; // when to shut the sensor down and wake it, call powerTrigger() from any other wake source
+PowerStats powerStats;
+#endif
+TelemetryEncoder telemetry;
+uint8_t telemetrySeq = 0;
+volatile bool acquire = true; // motion interrupt may read the sensor (not in frame capture mode or shut down)
+TaskScheduler tasks; // loop() runs the tasks below in turn, see TaskScheduler.h
+TaskStats taskStats[TASK_MAX];
+
+#define FRAME_SLICE_US 5000 // time budget per frameTask() run for building a frame
 
 PAW3902 opticalFlow(CSPIN); // Instantiate PAW3902
 
@@ -63,10 +123,30 @@ void setup() {
   while(1) { }
   }
 
-  opticalFlow.setMode(mode);
+  opticalFlow.setMode(mode); // before attachInterrupt(), so no burst can land mid change
+  lightModeInit(&lightMode, NULL); // default thresholds, pass a LightModeConfig to tune
+#if SENSOR_HEIGHT_MM
+  velocityInit(&velocity, NULL, SENSOR_HEIGHT_MM); // default scale and noise, pass a VelocityConfig to tune
+#endif
+  telemetryInit(&telemetry, telemetryWrite);
+#if POWER_IDLE_MS
+  PowerConfig powerConfig = powerDefaults;
+  powerConfig.idleMicros = POWER_IDLE_MS * 1000UL;
+  powerConfig.wakeMicros = POWER_WAKE_MS * 1000UL;
+  powerInit(&power, &powerConfig, micros());
+#endif
 
   digitalWrite(myLed, HIGH);
 
+  uint32_t now = micros();
+  taskInit(&tasks, now);
+  taskAdd(&tasks, "motion", motionTask, MOTION_TASK_US, MOTION_DEADLINE_US, now);
+  taskAdd(&tasks, "mode",   modeTask,   MODE_TASK_US,   0, now);
+  taskAdd(&tasks, "output", outputTask, OUTPUT_TASK_US, OUTPUT_DEADLINE_US, now);
+  taskAdd(&tasks, "frame",  frameTask,  FRAME_TASK_US,  FRAME_DEADLINE_US, now);
+  taskAdd(&tasks, "report", reportTask, REPORT_TASK_US, 0, now);
+
+  SPI.usingInterrupt(MOT); // keep the motion interrupt out of loop() SPI transactions
   attachInterrupt(MOT, myIntHandler, FALLING); // active LOW 
   status = opticalFlow.status();  // clear interrupt before entering main loop
   /* end of setup */
@@ -74,95 +154,157 @@ void setup() {
 
 void loop() {
   
-  // Navigation
-  if(motionDetect)
+#if PAW3902_PROFILE
+  if(Serial.available() && Serial.read() == 'p') opticalFlow.printProfile(); // send 'p' for a timing dump
+#endif
+
+  // One task per pass, earliest deadline first; the motion interrupt keeps reading meanwhile
+  uint8_t task = taskNext(&tasks, micros());
+  if(task == TASK_NONE) return;
+  uint32_t start = micros();
+  tasks.tasks[task].run();
+  taskDone(&tasks, task, start, micros());
+
+} // end of main loop
+
+
+// Navigation: rate every sample, feed the estimators and the light mode
+// hysteresis, and queue the sample for output
+void motionTask()
+{
+#if !ISR_ACQUISITION
+  if(motionDetect && acquire)
   {
    motionDetect = false;
-   iterations++;
    
 //   status = opticalFlow.status();
 //   opticalFlow.readMotionCount(&deltaX, &deltaY, &SQUAL, &Shutter); 
 
-   opticalFlow.readBurstMode(dataArray);
-   deltaX = ((int16_t)dataArray[3] << 8) | dataArray[2];
-   deltaY = ((int16_t)dataArray[5] << 8) | dataArray[4];
-   SQUAL = dataArray[6];
-   RawDataSum = dataArray[7];
-   Shutter = ((uint16_t)dataArray[10] << 8) | dataArray[11];
-   Shutter &= 0x1FFF;
-
-   mode =    opticalFlow.getMode();
-   // Don't report data if under thresholds
-   if((mode == bright       ) && (SQUAL < 25) && (Shutter >= 0x1FF0)) deltaX = deltaY = 0;
-   if((mode == lowlight     ) && (SQUAL < 70) && (Shutter >= 0x1FF0)) deltaX = deltaY = 0;
-   if((mode == superlowlight) && (SQUAL < 85) && (Shutter >= 0x0BC0)) deltaX = deltaY = 0;
-
-   // Switch brightness modes automagically
-
-   // switch from lowlight to bright when shutter value < 3000 for 10 iterations
-   if((mode == lowlight) && (Shutter < 0x0BB8))
-   {
-       count0++;
-       if(count0 >= 10) opticalFlow.setMode(bright);
-   }
-   else 
-   {
-       count0 = 0;
-   }
-
-   // switch from superlowlight to lowlight when shutter value < 1000 for ten iterations
-   if((mode == superlowlight) && (Shutter < 0x03E8))
-   {
-       count1++;
-       if(count1 >= 10) opticalFlow.setMode(lowlight);
-   }
-   else 
-   {
-       count1 = 0;
-   }
-
-   // switch from bright to lowlight when shutter value >= 7711 for ten iterations
-   if((mode == bright) && (Shutter >= 0x1E1F) && (RawDataSum < 0x3C))
-   {
-       count2++;
-       if(count2 >= 10) opticalFlow.setMode(lowlight);
-   }
-   else 
-   {
-       count2 = 0;
-   }
-
-   // switch from lowlight to superlowlight when shutter value >= 7711 for ten iterations
-   if((mode == lowlight) && (Shutter >= 0x1E1F) && (RawDataSum < 0x5A))
-   {
-       count3++;
-       if(count3 >= 10) opticalFlow.setMode(superlowlight);
-   }
-   else 
-   {
-       count3 = 0;
-   }
-   
-   // Drop out of superlowlight mode as soon as the Shutter less than 500
-   if((mode == superlowlight) && (Shutter < 0x01F4)) opticalFlow.setMode(lowlight);
-   
-   Serial.print("X: ");Serial.print(deltaX);Serial.print(", Y: ");Serial.println(deltaY);
+   acquireSample();
+  }
+#endif
+
+  if(motionRingCount(&motionRing)) moved = true;
+
+  while(motionRingPop(&motionRing, &sample))
+  {
+   lightModeRate(&lightMode, &sample); // confidence and validity, the counts are passed on as read
+#if POWER_IDLE_MS
+   powerSample(&power, &sample);
+#endif
+#if SENSOR_HEIGHT_MM
+   velocityUpdate(&velocity, &sample); // weighs each sample by its confidence
+#endif
+
+   // Switch brightness modes automagically, the switch itself waits for modeTask()
+   newMode = lightModeUpdate(&lightMode, &sample);
+   if(newMode != LIGHTMODE_HOLD) pendingMode = newMode;
+
+   motionRingPush(&outputRing, &sample); // overruns count samples the output could not keep up with
+  }
+}
+
+
+// Light mode switching and sensor power, the register writes kept out of motionTask()
+void modeTask()
+{
+  if(moved) iterations++; // count passes with motion, not samples
+  moved = false;
+
+  if(pendingMode != LIGHTMODE_HOLD && acquire)
+  {
+   acquire = false; // switchMode() gives the bus back while in bank 7, see resumeAcquisition()
+   opticalFlow.switchMode(pendingMode);
+   pendingMode = LIGHTMODE_HOLD;
+   resumeAcquisition();
+  }
+
+#if POWER_IDLE_MS
+  // Sensor power, only while navigating
+  if(frameStep == 0) switch(powerPoll(&power, micros()))
+  {
+   case POWER_SHUTDOWN:
+    acquire = false;
+    opticalFlow.shutdown();
+#if !TELEMETRY_BINARY
+    powerTake(&power, micros(), &powerStats); // since the last shutdown
+    Serial.print("Sensor shut down. Awake: ");Serial.print(powerStats.awakePermille / 10.0f, 1);Serial.print("%, wakes: ");Serial.print(powerStats.wakes);
+    Serial.print(" ("); Serial.print(powerStats.triggered);Serial.print(" triggered, ");Serial.print(powerStats.quiet);Serial.println(" quiet)");
+    Serial.print("wake() max: ");Serial.print(powerStats.maxWakeMicros);Serial.print(" us, to first sample mean/max: ");Serial.print(powerStats.meanDataMicros);
+    Serial.print("/");Serial.print(powerStats.maxDataMicros);Serial.print(" us, samples lost: ");Serial.println(powerStats.samplesLost);
+#endif
+    break;
+   case POWER_WAKE:
+    acquire = false; // a frame capture may have turned reads back on meanwhile
+    opticalFlow.wake();
+    powerAwake(&power, micros());
+    resumeAcquisition();
+    break;
+  }
+#endif
+}
+
+
+// Every queued sample as telemetry or text
+void outputTask()
+{
+  while(motionRingPop(&outputRing, &sample))
+  {
+   deltaX = sample.deltaX;
+   deltaY = sample.deltaY;
+   SQUAL = sample.SQUAL;
+   RawDataSum = sample.RawDataSum;
+   Shutter = sample.Shutter;
+   mode =    sample.mode;
+
+#if TELEMETRY_BINARY
+   telemetrySendMotion(&telemetry, &sample, telemetrySeq++); // 19 bytes, gaps in seq count ring overruns
+#else
+   Serial.print("X: ");Serial.print(deltaX);Serial.print(", Y: ");Serial.print(deltaY);
+   Serial.print(", confidence: ");Serial.print(sample.confidence);Serial.println(sample.valid ? "" : " (under thresholds)");
+#if SENSOR_HEIGHT_MM
+   Serial.print("Velocity X: ");Serial.print(velocityMillimetresPerSecond(velocity.vx));
+   Serial.print(", Y: ");Serial.print(velocityMillimetresPerSecond(velocity.vy));Serial.println(" mm/s");
+#endif
    Serial.print("SQUAL: ");Serial.print(SQUAL);Serial.print(", Shutter: 0x");Serial.println(Shutter, HEX);
-   Serial.print("RawDataSum: 0x");Serial.print(RawDataSum, HEX);Serial.print(", mode: ");Serial.println(mode); 
+   Serial.print("RawDataSum: 0x");Serial.print(RawDataSum, HEX);Serial.print(", mode: ");Serial.print(mode);
+   Serial.print(", overruns: ");Serial.print(motionRing.overruns);Serial.print("/");Serial.println(outputRing.overruns);
+#endif
   }
+}
+
 
-  // Frame capture
-  if(iterations >= 25) // capture one frame per 25 iterations of navigation
+// Frame capture, built a slice at a time so the other tasks keep running
+void frameTask()
+{
+  if(frameStep == 0 && iterations >= 25) // capture one frame per 25 mode task passes with motion
   {
     iterations = 0;
+#if !TELEMETRY_BINARY
     Serial.println("Hold camera still for frame capture!");
-    delay(4000);
-    
+#endif
+    frameTimer = millis();
+    frameStep = 1;
+  }
+
+  if(frameStep == 1 && millis() - frameTimer >= 4000)
+  {
+    acquire = false;
     opticalFlow.enterFrameCaptureMode();
-    
-    for(uint8_t kk = 0; kk < 5; kk++) // capture 5 frames then go back to navigating
+    opticalFlow.startFrame(frameArray, &imageStats);
+    frameCount = 0;
+    frameStep = 2;
+  }
+
+  if(frameStep == 2 && (frameState = opticalFlow.serviceFrame(35*35, FRAME_SLICE_US)) != PAW3902_FRAME_BUSY)
+  {
+    if(frameState == PAW3902_FRAME_DONE)
     {
-      opticalFlow.captureFrame(frameArray);
+#if FRAME_EXPORT
+      // Shutter is from the last navigation sample, the sensor does not report it in frame capture mode
+      FrameHeader frameHeader = { frameIndex, (uint16_t)Shutter, opticalFlow.getMode(), FRAME_EXPORT == 2 ? FRAME_DELTA_RLE : FRAME_RAW };
+      frameExportSend(&telemetry, frameArray, &frameHeader);
+#else
       for(uint8_t ii = 0; ii < 35; ii++) // plot the frame data on the serial monitor (TFT display would be better)
       {
         Serial.print(ii); Serial.print(" "); 
@@ -172,20 +314,121 @@ void loop() {
         }
         Serial.println(" ");
       }
-      Serial.println(" ");
+#if FRAME_CORNERS
+      uint16_t cornerCount = frameFeatures(frameArray, CORNER_THRESHOLD, corners, FRAME_CORNERS);
+      Serial.print("Corners (x, y, score):");
+      for(uint16_t ii = 0; ii < cornerCount; ii++)
+      {
+        Serial.print(" "); Serial.print(corners[ii].x); Serial.print(","); Serial.print(corners[ii].y); Serial.print(","); Serial.print(corners[ii].score);
+      }
+      Serial.println(cornerCount == FRAME_CORNERS ? " ..." : "");
+#endif
+      Serial.print("Min/max: "); Serial.print(imageStats.min); Serial.print("/"); Serial.print(imageStats.max);
+      Serial.print(", mean: "); Serial.print(imageStats.mean); Serial.print(", variance: "); Serial.print(imageStats.variance);
+      Serial.print(", sharpness: "); Serial.println(imageStats.sharpness);
+#endif
+    }
+#if !TELEMETRY_BINARY
+    else
+    {
+      Serial.println("Frame capture timed out!");
+    }
+    PAW3902FrameStats frameStats = opticalFlow.getFrameStats();
+    Serial.print("Slices: "); Serial.print(frameStats.slices); Serial.print(", max slice (us): "); Serial.println(frameStats.maxSliceMicros);
+    Serial.println(" ");
+#endif
+    frameIndex++;
+
+    if(++frameCount < 5) // capture 5 frames then go back to navigating
+    {
+      opticalFlow.startFrame(frameArray, &imageStats);
+    }
+    else
+    {
+      opticalFlow.exitFrameCaptureMode(); // exit fram capture mode
+      digitalWrite(RST, LOW); delay(10); digitalWrite(RST, HIGH); // toggle reset to return to navigation mode
+      opticalFlow.initRegisters(opticalFlow.getMode()); // reload the mode registers so switchMode() starts from a known state
+#if !TELEMETRY_BINARY
+      Serial.println("Back in Navigation mode!");
+#endif
+      resumeAcquisition();
+      frameStep = 0;
     }
-  
-    opticalFlow.exitFrameCaptureMode(); // exit fram capture mode
-    digitalWrite(RST, LOW); delay(10); digitalWrite(RST, HIGH); // toggle reset to return to navigation mode
-    Serial.println("Back in Navigation mode!");
   }
+}
 
-  delay(100); // report at 10 Hz
-  
-} // end of main loop
+
+// Displacement totals and task timing once a second
+void reportTask()
+{
+  motionTake(&motionAccumulator, &totals); // displacement since the last report, nothing dropped
+  uint16_t busyPermille = taskTake(&tasks, micros(), taskStats);
+#if !TELEMETRY_BINARY
+  if(totals.samples)
+  {
+   Serial.print("Total X: ");Serial.print(totals.deltaX);Serial.print(", Y: ");Serial.print(totals.deltaY);
+   Serial.print(", samples: ");Serial.print(totals.samples);
+   Serial.print(", SQUAL: ");Serial.print(totals.minSQUAL);Serial.print("-");Serial.println(totals.maxSQUAL);
+  }
+  Serial.print("Tasks busy: ");Serial.print(busyPermille / 10.0f, 1);Serial.println("%");
+  for(uint8_t ii = 0; ii < tasks.count; ii++)
+  {
+   Serial.print(tasks.tasks[ii].name);Serial.print(": ");Serial.print(taskStats[ii].runs);Serial.print(" runs, ");
+   Serial.print(taskStats[ii].misses);Serial.print(" missed, ");Serial.print(taskStats[ii].skipped);Serial.print(" skipped, max run/response: ");
+   Serial.print(taskStats[ii].maxRunMicros);Serial.print("/");Serial.print(taskStats[ii].maxResponseMicros);Serial.println(" us");
+  }
+#endif
+}
+
+
+void telemetryWrite(const uint8_t * data, uint16_t length)
+{
+  Serial.write(data, length);
+}
+
+
+// Motion reads back on after a mode change, shutdown or frame capture.
+// PAW3902ArduinoBus::settle() ends the SPI transaction for the waits inside
+// setMode(), switchMode() and wake(), so SPI.usingInterrupt() does not hold
+// the motion interrupt off there and acquire has to, as changeMode() masks
+// it on the MAX32660. An interrupt that fell meanwhile was only flagged, and
+// MOT stays low until the next burst read, so read it here. acquire stays
+// clear until none is left, so the handler never pushes to motionRing or
+// motionAccumulator while this does.
+void resumeAcquisition()
+{
+#if ISR_ACQUISITION
+  noInterrupts();
+  while(motionDetect)
+  {
+    motionDetect = false;
+    interrupts();
+    acquireSample(); // MOT can fall again once the burst is read, the handler only flags it
+    noInterrupts();
+  }
+  acquire = true;
+  interrupts();
+#else
+  acquire = true;
+#endif
+}
+
+
+void acquireSample()
+{
+  PAW3902Sample newSample;
+  opticalFlow.readSample(&newSample);
+  motionRingPush(&motionRing, &newSample);
+  motionAccumulate(&motionAccumulator, &newSample);
+}
 
 
 void myIntHandler()
 {
+#if ISR_ACQUISITION
+  if(!acquire) { motionDetect = true; return; } // read by resumeAcquisition()
+  acquireSample();
+#else
   motionDetect = true;
+#endif
 }
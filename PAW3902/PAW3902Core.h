@@ -0,0 +1,563 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __PAW3902CORE_H
+#define __PAW3902CORE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "PAW3902Tables.h"
+#include "PAW3902Sample.h"
+#include "PAW3902Profile.h"
+#include "FrameImageStats.h"
+
+// Register logic shared by every port, specialized at compile time on a bus
+// policy so the hot paths inline straight into the transport. A Bus provides
+//
+//   void     begin()                    pins, then the chip select pulse that resets the sensor's SPI port
+//   void     beginTransaction()         claim the bus for a run of accesses
+//   void     endTransaction()
+//   void     write(reg, value)          one framed register write inside a transaction
+//   uint8_t  read(reg)                  one framed register read inside a transaction, tSRAD included
+//   void     readBurst(data)            the 12-byte 0x16 motion burst, own transaction
+//   void     beginStream()              frame capture: hold chip select where the bus allows
+//   uint8_t  streamRead(reg)            one read inside the stream, tSRAD included
+//   void     endStream()
+//   bool     settle(ms)                 wait out a table's settle delay mid-sequence; true if the
+//                                       transaction had to be released and claimed again
+//   void     delayMicros(us), delayMillis(ms)
+//   uint32_t micros()
+//   uint32_t ticks(), ticksPerMicro()   profiling clock, only needed with PAW3902_PROFILE
+//
+// Every command leaves the next one to wait tSWW after a write and tSRR after
+// a read; the bus keeps that gap across calls and transactions, so the core
+// never sleeps for it (see PAW3902_DEADLINE_GAPS).
+//
+// Backends: PAW3902ArduinoBus (PAW3902.h), the MAX32660 SPI17Y bus
+// (MAX32660/PAW3902.cpp), the Linux spidev bus (Linux/PAW3902Spidev.h) and
+// the host bus (host/PAW3902HostBus.h).
+
+#define PAW3902_FRAME_RETRIES 255 // valid-bit polls per half pixel before a capture gives up
+
+// Frame grabber states returned by serviceFrame()
+#define PAW3902_FRAME_IDLE    0
+#define PAW3902_FRAME_BUSY    1
+#define PAW3902_FRAME_DONE    2
+#define PAW3902_FRAME_TIMEOUT 3 // valid bits never came up
+#define PAW3902_FRAME_ABORTED 4
+
+// Counters for the last frame capture
+typedef struct {
+  uint16_t pixels;          // pixels captured
+  uint32_t upperRetries;    // polls spent waiting for the upper six bits
+  uint32_t lowerRetries;    // polls spent waiting for the lower two bits
+  uint32_t micros;          // time spent capturing, summed over slices
+  uint32_t pixelsPerSecond;
+  uint16_t slices;          // serviceFrame() calls that moved pixels
+  uint32_t maxSliceMicros;  // longest single slice
+} PAW3902FrameStats;
+
+#if PAW3902_PROFILE
+#define PAW3902_PROFILE_SCOPE(op) ProfileScope profileScope(*this, op)
+#define PAW3902_PROFILE_BYTES(n)  (_profileBytes += (n))
+#define PAW3902_PROFILE_DELAY(us) (_profileDelay += (us))
+#else
+#define PAW3902_PROFILE_SCOPE(op)
+#define PAW3902_PROFILE_BYTES(n)  ((void)0)
+#define PAW3902_PROFILE_DELAY(us) ((void)0)
+#endif
+
+template <class Bus>
+class PAW3902Core {
+public:
+  PAW3902Core(const Bus & bus = Bus())
+    : _bus(bus), _mode(0xFF), _reg6D(0), _frame(NULL), _image(NULL), _framePixel(0), _frameState(PAW3902_FRAME_IDLE)
+  {
+#if PAW3902_PROFILE
+    resetProfile();
+#endif
+  }
+  bool begin();
+  uint8_t status();
+  void initRegisters(uint8_t mode);
+  void readMotionCount(int16_t *deltaX, int16_t *deltaY, uint8_t *SQUAL, uint16_t *Shutter);
+  void readBurstMode(uint8_t * dataArray) { PAW3902_PROFILE_SCOPE(PAW3902_OP_BURST); readBurst(dataArray); }
+  void readSample(PAW3902Sample * sample);
+  bool checkID(uint8_t * productID = NULL, uint8_t * revisionID = NULL, uint8_t * inverseProductID = NULL);
+  void setMode(uint8_t mode);
+  void switchMode(uint8_t mode);
+  void reset();
+  void shutdown();
+  void wake();
+  uint8_t getMode() { return _mode; }
+  void enterFrameCaptureMode();
+  uint8_t captureFrame(uint8_t * frameArray, FrameImageStats * image = NULL);
+  void startFrame(uint8_t * frameArray, FrameImageStats * image = NULL);
+  uint8_t serviceFrame(uint16_t maxPixels, uint32_t budgetMicros);
+  uint16_t frameProgress() { return _framePixel; }
+  void abortFrame();
+  void exitFrameCaptureMode();
+  PAW3902FrameStats getFrameStats() { return _frameStats; }
+  PAW3902SequenceStats getSequenceStats() { return _seqStats; }
+  Bus & bus() { return _bus; }
+#if PAW3902_PROFILE
+  const PAW3902OpProfile & getProfile(uint8_t op) { return _profile[op]; }
+  uint32_t ticksPerMicro() { return _bus.ticksPerMicro(); }
+  void resetProfile() { memset(_profile, 0, sizeof(_profile)); _profileBytes = _profileDelay = 0; }
+#endif
+
+protected:
+  Bus _bus;
+  uint8_t _mode, _reg6D;
+  PAW3902SequenceStats _seqStats;
+  PAW3902FrameStats _frameStats;
+  uint8_t * _frame;
+  FrameImageStats * _image;
+  uint16_t _framePixel;
+  uint8_t _frameState;
+  void writeByte(uint8_t reg, uint8_t value);
+  uint8_t readByte(uint8_t reg);
+  void runSequence(const PAW3902RegWrite * table, uint8_t length);
+
+  void readBurst(uint8_t * dataArray)
+  {
+    PAW3902_PROFILE_BYTES(13);
+    PAW3902_PROFILE_DELAY(PAW3902_tSRAD);
+    _bus.readBurst(dataArray);
+  }
+
+  uint8_t streamRead(uint8_t reg)
+  {
+    PAW3902_PROFILE_BYTES(2);
+    PAW3902_PROFILE_DELAY(PAW3902_tSRAD);
+    return _bus.streamRead(reg);
+  }
+
+  void delayMicros(uint32_t us) { PAW3902_PROFILE_DELAY(us); _bus.delayMicros(us); }
+  void delayMillis(uint32_t ms) { PAW3902_PROFILE_DELAY(1000UL * ms); _bus.delayMillis(ms); }
+
+#if PAW3902_PROFILE
+  PAW3902OpProfile _profile[PAW3902_OPS];
+  uint32_t _profileBytes, _profileDelay; // running totals, differenced by ProfileScope
+
+  // Charges the enclosing call's time, bytes and delays to one operation
+  struct ProfileScope {
+    PAW3902Core & core;
+    uint8_t op;
+    uint32_t start, bytes, delay;
+
+    ProfileScope(PAW3902Core & c, uint8_t o)
+      : core(c), op(o), start(c._bus.ticks()), bytes(c._profileBytes), delay(c._profileDelay) { }
+
+    ~ProfileScope()
+    {
+      uint32_t elapsed = core._bus.ticks() - start;
+      PAW3902OpProfile & p = core._profile[op];
+      p.calls++;
+      p.ticks += elapsed;
+      if(elapsed > p.maxTicks) p.maxTicks = elapsed;
+      p.bytes += core._profileBytes - bytes;
+      p.delayMicros += core._profileDelay - delay;
+    }
+  };
+#endif
+};
+
+
+template <class Bus>
+bool PAW3902Core<Bus>::begin()
+{
+  PAW3902_PROFILE_SCOPE(PAW3902_OP_BEGIN);
+
+  _bus.begin(); // make sure the SPI bus is reset
+
+  reset();
+
+  // Reading the motion registers one time
+  for (uint8_t ii = 0; ii < 5; ii++)
+  {
+    readByte(0x02 + ii);
+    delayMicros(2);
+  }
+
+  // Latch the power-on value of bank 0x05 register 0x6D, which only the
+  // lowlight and superlowlight sequences write (see switchMode())
+  writeByte(0x7F, 0x05);
+  _reg6D = readByte(0x6D);
+  writeByte(0x7F, 0x00);
+
+  _mode = 0xFF; // nothing loaded yet, so setMode() runs the full sequence
+  setMode(lowlight); // set mode to lowlight as default
+
+  return true;
+}
+
+
+template <class Bus>
+void PAW3902Core<Bus>::setMode(uint8_t mode)
+{
+ if(mode == _mode) return;
+ PAW3902_PROFILE_SCOPE(PAW3902_OP_SETMODE);
+
+ _mode = mode;
+ reset();
+ initRegisters(mode);
+}
+
+
+// Rows of modeRegisterTable in the protected bank 0x0E, for switchMode()'s buffer bound
+constexpr uint8_t paw3902ProtectedModeRegs(uint8_t ii = 0)
+{
+  return ii == PAW3902_TABLE_LENGTH(modeRegisterTable) ? 0
+       : (modeRegisterTable[ii].bank == 0x0E) + paw3902ProtectedModeRegs(ii + 1);
+}
+
+
+// Change light mode without a reset: write only the registers that differ
+// between the current and target mode, then restart the pipeline
+template <class Bus>
+void PAW3902Core<Bus>::switchMode(uint8_t mode)
+{
+ if(mode == _mode) return;
+ if(_mode > superlowlight) { setMode(mode); return; } // current register state unknown
+ PAW3902_PROFILE_SCOPE(PAW3902_OP_SWITCHMODE);
+
+ PAW3902RegWrite seq[40];
+ uint8_t n = 0, bank = 0xFF;
+ // Worst case, every row differs: 10 writes for a bank 0x0E row with its unlock and relock,
+ // a bank select and a write for any other row, and the 9 of the restart
+ static_assert(10 * paw3902ProtectedModeRegs() + 2 * (PAW3902_TABLE_LENGTH(modeRegisterTable) - paw3902ProtectedModeRegs()) + 9
+               <= sizeof(seq) / sizeof(seq[0]), "switchMode() sequence buffer too small for modeRegisterTable");
+
+ for(uint8_t ii = 0; ii < PAW3902_TABLE_LENGTH(modeRegisterTable); ii++)
+ {
+   const PAW3902ModeReg &r = modeRegisterTable[ii];
+   uint8_t from = r.value[_mode], to = r.value[mode];
+   if(r.bank == 0x05 && r.reg == 0x6D)
+   {
+     if(_mode == bright) from = _reg6D;
+     if(mode == bright) to = _reg6D;
+   }
+   if(from == to) continue;
+
+   if(r.bank == 0x0E)
+   {
+     seq[n++] = {0x7F, 0x00, 0};
+     seq[n++] = {0x55, 0x01, 0};
+     seq[n++] = {0x50, 0x07, 0};
+     seq[n++] = {0x7F, 0x0E, 0};
+     seq[n++] = {r.reg, to, 0};
+     seq[n++] = {0x7F, 0x00, 0};
+     seq[n++] = {0x51, 0x7B, 0};
+     seq[n++] = {0x50, 0x00, 0};
+     seq[n++] = {0x55, 0x00, 0};
+     seq[n++] = {0x55, 0x80, 0}; // the value the full sequences leave behind
+     bank = 0x00;
+     continue;
+   }
+
+   if(r.bank != bank)
+   {
+     seq[n++] = {0x7F, r.bank, 0};
+     bank = r.bank;
+   }
+   seq[n++] = {r.reg, to, 0};
+ }
+
+ seq[n++] = {0x7F, 0x07, 0};
+ seq[n++] = {0x40, 0x41, modeSettleMs[mode]};
+ seq[n++] = {0x7F, 0x00, 0};
+ seq[n++] = {0x32, modeReg32[mode], 0};
+ seq[n++] = {0x7F, 0x07, 0};
+ seq[n++] = {0x40, 0x40, 0};
+ seq[n++] = {0x7F, 0x00, 0};
+ seq[n++] = {0x73, modeReg73[mode], modeSettleMs[mode]};
+ seq[n++] = {0x73, 0x00, 0};
+
+ _mode = mode;
+ runSequence(seq, n);
+}
+
+
+template <class Bus>
+void PAW3902Core<Bus>::initRegisters(uint8_t mode)
+{
+  switch(mode)
+  {
+  case 0: // Bright
+  runSequence(initBrightTable, PAW3902_TABLE_LENGTH(initBrightTable));
+  break;
+
+  case 1: // Low Light
+  runSequence(initLowLightTable, PAW3902_TABLE_LENGTH(initLowLightTable));
+  break;
+
+  case 2: // Super Low Light
+  runSequence(initSuperLowLightTable, PAW3902_TABLE_LENGTH(initSuperLowLightTable));
+  break;
+  }
+}
+
+
+template <class Bus>
+bool PAW3902Core<Bus>::checkID(uint8_t * productID, uint8_t * revisionID, uint8_t * inverseProductID)
+{
+  // check device ID
+  uint8_t product_ID = readByte(0x00);
+  uint8_t revision_ID = readByte(0x01);
+  uint8_t inverse_product_ID = readByte(0x5F);
+
+  if(productID) *productID = product_ID;
+  if(revisionID) *revisionID = revision_ID;
+  if(inverseProductID) *inverseProductID = inverse_product_ID;
+
+  if (product_ID != 0x49 && inverse_product_ID != 0xB6) return false;
+  return true;
+}
+
+
+template <class Bus>
+void PAW3902Core<Bus>::reset()
+{
+  // Power on reset
+  writeByte(0x3A, 0x5A);
+  delayMillis(1);
+}
+
+
+template <class Bus>
+void PAW3902Core<Bus>::shutdown()
+{
+  // Shutdown
+  writeByte(0x3B, 0xB6);
+}
+
+
+// Out of shutdown() the short way: the power-on reset a wake needs, then the
+// current mode's table. begin() would also pulse chip select, re-latch 0x6D
+// (a power-on value, so unchanged) and load lowlight before the real mode.
+template <class Bus>
+void PAW3902Core<Bus>::wake()
+{
+  PAW3902_PROFILE_SCOPE(PAW3902_OP_WAKE);
+
+  reset();
+  for (uint8_t ii = 0; ii < 5; ii++) readByte(0x02 + ii); // clear the motion registers, releasing the motion pin
+  if(_mode > superlowlight) _mode = lowlight;
+  initRegisters(_mode);
+}
+
+
+template <class Bus>
+uint8_t PAW3902Core<Bus>::status()
+{
+  return readByte(0x02);
+}
+
+
+template <class Bus>
+void PAW3902Core<Bus>::readMotionCount(int16_t *deltaX, int16_t *deltaY, uint8_t *SQUAL, uint16_t *Shutter)
+{
+  PAW3902_PROFILE_SCOPE(PAW3902_OP_MOTIONCOUNT);
+  *deltaX =  ((int16_t) readByte(0x04) << 8) | readByte(0x03);
+  *deltaY =  ((int16_t) readByte(0x06) << 8) | readByte(0x05);
+  *SQUAL =              readByte(0x07);
+  *Shutter = ((uint16_t)readByte(0x0C) << 8) | readByte(0x0B);
+}
+
+
+// Burst read decoded into a sample stamped with micros(); safe to call from
+// the motion interrupt as long as the bus is not in use by the interrupted code
+template <class Bus>
+void PAW3902Core<Bus>::readSample(PAW3902Sample * sample)
+{
+  PAW3902_PROFILE_SCOPE(PAW3902_OP_BURST);
+  uint32_t timestamp = _bus.micros();
+  uint8_t dataArray[12];
+  readBurst(dataArray);
+  decodeBurst(dataArray, timestamp, _mode, sample);
+}
+
+
+template <class Bus>
+inline void PAW3902Core<Bus>::writeByte(uint8_t reg, uint8_t value)
+{
+  PAW3902_PROFILE_BYTES(2);
+  _bus.beginTransaction();
+  _bus.write(reg, value);
+  _bus.endTransaction();
+}
+
+
+template <class Bus>
+inline uint8_t PAW3902Core<Bus>::readByte(uint8_t reg)
+{
+  PAW3902_PROFILE_BYTES(2);
+  PAW3902_PROFILE_DELAY(PAW3902_tSRAD);
+  _bus.beginTransaction();
+  uint8_t temp = _bus.read(reg);
+  _bus.endTransaction();
+  return temp;
+}
+
+
+// Push a register table out as one bus transaction. Settle delays inside the
+// table go to the bus, which either queues them with the writes or releases
+// the transaction for the wait; a trailing settle delay runs after release.
+template <class Bus>
+void PAW3902Core<Bus>::runSequence(const PAW3902RegWrite * table, uint8_t length)
+{
+  PAW3902_PROFILE_SCOPE(PAW3902_OP_SEQUENCE);
+  _seqStats.writes = 0;
+  _seqStats.transactions = 1;
+  _seqStats.waitMicros = 0;
+
+  uint8_t delayMs = 0;
+  _bus.beginTransaction();
+
+  for(uint8_t ii = 0; ii < length; ii++)
+  {
+    if(delayMs)
+    {
+      PAW3902_PROFILE_DELAY(1000UL * delayMs);
+      if(_bus.settle(delayMs)) _seqStats.transactions++;
+    }
+
+    PAW3902_PROFILE_BYTES(2);
+    _bus.write(table[ii].reg, table[ii].value);
+
+    delayMs = table[ii].delayMs;
+    _seqStats.writes++;
+    _seqStats.waitMicros += 1000UL * delayMs;
+  }
+
+  _bus.endTransaction();
+
+  if(delayMs) delayMillis(delayMs);
+}
+
+
+template <class Bus>
+void PAW3902Core<Bus>::enterFrameCaptureMode()
+{
+  setMode(lowlight); // make sure not in superlowlight mode for frame capture
+
+  runSequence(enterFrameCaptureTable, PAW3902_TABLE_LENGTH(enterFrameCaptureTable));
+}
+
+
+// Blocking capture: the whole frame in one slice
+template <class Bus>
+uint8_t PAW3902Core<Bus>::captureFrame(uint8_t * frameArray, FrameImageStats * image)
+{
+  PAW3902_PROFILE_SCOPE(PAW3902_OP_CAPTURE);
+  startFrame(frameArray, image);
+  return serviceFrame(35*35, 0) == PAW3902_FRAME_DONE;
+}
+
+
+// Non-blocking capture: startFrame() triggers the sensor, then each
+// serviceFrame() call moves up to maxPixels pixels, or stops at the first
+// pixel boundary past budgetMicros (0 = no time limit). A slice therefore
+// lasts at most budgetMicros plus one pixel, and one pixel is bounded by
+// PAW3902_FRAME_RETRIES polls per half. With image, its statistics are
+// built up pixel by pixel as the frame is (FrameImageStats.h) and are
+// current for the pixels captured after every slice.
+template <class Bus>
+void PAW3902Core<Bus>::startFrame(uint8_t * frameArray, FrameImageStats * image)
+{
+  writeByte(0x7F, 0x00);
+  writeByte(0x58, 0xFF); // start frame capture mode
+
+  _frame = frameArray;
+  _image = image;
+  if(_image) frameImageBegin(_image);
+  _framePixel = 0;
+  _frameState = PAW3902_FRAME_BUSY;
+  memset(&_frameStats, 0, sizeof(_frameStats));
+}
+
+
+// Each slice streams its pixels as one bus stream; where the bus can hold
+// chip select, only what is left of the tSRAD/tSRR gaps separates the 0x58 reads
+template <class Bus>
+uint8_t PAW3902Core<Bus>::serviceFrame(uint16_t maxPixels, uint32_t budgetMicros)
+{
+  if(_frameState != PAW3902_FRAME_BUSY) return _frameState;
+  PAW3902_PROFILE_SCOPE(PAW3902_OP_FRAMESLICE);
+
+  uint8_t rawDataUpper = 0, rawDataLower = 0, tries = 0;
+  uint16_t last = (maxPixels < 35*35 - _framePixel) ? _framePixel + maxPixels : 35*35;
+  uint32_t start = _bus.micros();
+
+  _bus.beginStream();
+
+  while(_framePixel < last)
+  {
+    rawDataUpper = streamRead(0x58);
+    for(tries = 0; (rawDataUpper & 0xC0) != 0x40 && tries < PAW3902_FRAME_RETRIES; tries++) { rawDataUpper = streamRead(0x58); } // wait for upper six bits of raw data to be valid
+    _frameStats.upperRetries += tries;
+    if((rawDataUpper & 0xC0) != 0x40) { _frameState = PAW3902_FRAME_TIMEOUT; break; } // the last retry may still have read it valid
+
+    rawDataLower = streamRead(0x58);
+    for(tries = 0; (rawDataLower & 0xC0) != 0x80 && tries < PAW3902_FRAME_RETRIES; tries++) { rawDataLower = streamRead(0x58); } // wait for lower two bits of raw data to be valid
+    _frameStats.lowerRetries += tries;
+    if((rawDataLower & 0xC0) != 0x80) { _frameState = PAW3902_FRAME_TIMEOUT; break; }
+
+    _frame[_framePixel] = (rawDataUpper & 0x3F) << 2 | (rawDataLower & 0x0C) >> 2;
+    if(_image) frameImagePixel(_image, _frame, _framePixel);
+    _framePixel++;
+
+    if(budgetMicros && (_bus.micros() - start) >= budgetMicros) break;
+  }
+
+  _bus.endStream();
+  if(_image) frameImageEnd(_image);
+
+  uint32_t slice = _bus.micros() - start;
+  _frameStats.slices++;
+  _frameStats.micros += slice;
+  if(slice > _frameStats.maxSliceMicros) _frameStats.maxSliceMicros = slice;
+  _frameStats.pixels = _framePixel;
+  _frameStats.pixelsPerSecond = _frameStats.micros ? (uint32_t)(1000000ULL * _framePixel / _frameStats.micros) : 0;
+
+  if(_framePixel == 35*35) _frameState = PAW3902_FRAME_DONE;
+  return _frameState;
+}
+
+
+// Stop building the current frame; the sensor stays in frame capture mode and
+// the next startFrame() triggers a fresh frame
+template <class Bus>
+void PAW3902Core<Bus>::abortFrame()
+{
+  if(_frameState == PAW3902_FRAME_BUSY) _frameState = PAW3902_FRAME_ABORTED;
+}
+
+
+template <class Bus>
+void PAW3902Core<Bus>::exitFrameCaptureMode()
+{
+  runSequence(exitFrameCaptureTable, PAW3902_TABLE_LENGTH(exitFrameCaptureTable));
+}
+
+#endif //__PAW3902CORE_H
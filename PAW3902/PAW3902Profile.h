@@ -0,0 +1,69 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __PAW3902PROFILE_H
+#define __PAW3902PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Hot-path instrumentation in PAW3902Core. Off by default; when 0 the
+// counters, clock reads and bookkeeping compile away entirely. Set it here,
+// or on the compiler command line so every translation unit agrees.
+#ifndef PAW3902_PROFILE
+#define PAW3902_PROFILE 0
+#endif
+
+// Instrumented operations, the index into getProfile(). Counts are inclusive:
+// setMode() includes its runSequence(), begin() its setMode().
+#define PAW3902_OP_BEGIN       0
+#define PAW3902_OP_SETMODE     1
+#define PAW3902_OP_SWITCHMODE  2
+#define PAW3902_OP_SEQUENCE    3 // runSequence()
+#define PAW3902_OP_BURST       4 // readBurstMode() and readSample()
+#define PAW3902_OP_MOTIONCOUNT 5 // readMotionCount()
+#define PAW3902_OP_CAPTURE     6 // captureFrame()
+#define PAW3902_OP_FRAMESLICE  7 // serviceFrame()
+#define PAW3902_OP_WAKE        8 // wake()
+#define PAW3902_OPS            9
+
+typedef struct {
+  uint32_t calls;
+  uint64_t ticks;        // summed duration in bus clock ticks, see ticksPerMicro()
+  uint32_t maxTicks;     // longest single call
+  uint32_t bytes;        // SPI bytes moved
+  uint32_t delayMicros;  // deliberate waits: settle and reset delays, tSRAD; not the bus's tSWW/tSRR remainders
+} PAW3902OpProfile;
+
+// One line per operation for a dump; returns what snprintf() does
+static inline int paw3902FormatProfile(char * line, size_t size, uint8_t op, const PAW3902OpProfile * p, uint32_t ticksPerMicro)
+{
+  static const char * const names[PAW3902_OPS] = {
+    "begin", "setMode", "switchMode", "runSequence", "burst", "motionCount", "captureFrame", "serviceFrame", "wake"
+  };
+  return snprintf(line, size, "%-12s calls %lu, total %lu us, max %lu us, bytes %lu, delays %lu us",
+                  op < PAW3902_OPS ? names[op] : "?", (unsigned long)p->calls,
+                  (unsigned long)(p->ticks / ticksPerMicro), (unsigned long)(p->maxTicks / ticksPerMicro),
+                  (unsigned long)p->bytes, (unsigned long)p->delayMicros);
+}
+
+#endif //__PAW3902PROFILE_H
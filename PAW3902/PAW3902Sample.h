@@ -0,0 +1,56 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __PAW3902SAMPLE_H
+#define __PAW3902SAMPLE_H
+
+#include <stdint.h>
+
+// One decoded motion burst (register 0x16), stamped when it was read
+typedef struct {
+  uint32_t timestamp;   // us
+  int16_t  deltaX;
+  int16_t  deltaY;
+  uint16_t Shutter;
+  uint8_t  SQUAL;
+  uint8_t  RawDataSum;
+  uint8_t  mode;        // light mode the sensor was in
+  uint8_t  sensor;      // index on a shared bus, see SensorScheduler.h
+  uint8_t  confidence;  // 0 (no data) .. 255, see lightModeRate()
+  uint8_t  valid;       // 0 if the motion should not be reported in its mode
+} PAW3902Sample;
+
+static inline void decodeBurst(const uint8_t * dataArray, uint32_t timestamp, uint8_t mode, PAW3902Sample * sample)
+{
+  sample->timestamp  = timestamp;
+  sample->deltaX     = (int16_t)(((uint16_t)dataArray[3] << 8) | dataArray[2]);
+  sample->deltaY     = (int16_t)(((uint16_t)dataArray[5] << 8) | dataArray[4]);
+  sample->SQUAL      = dataArray[6];
+  sample->RawDataSum = dataArray[7];
+  sample->Shutter    = (((uint16_t)dataArray[10] << 8) | dataArray[11]) & 0x1FFF;
+  sample->mode       = mode;
+  sample->sensor     = 0;
+  sample->confidence = 255; // unrated until lightModeRate()
+  sample->valid      = 1;
+}
+
+#endif //__PAW3902SAMPLE_H
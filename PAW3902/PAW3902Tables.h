@@ -0,0 +1,450 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __PAW3902TABLES_H
+#define __PAW3902TABLES_H
+
+#include <stdint.h>
+
+// Register write sequences as {reg, value, post-delay} tables, pushed out by
+// runSequence(). delayMs is the settle time in ms required after the write;
+// the sequencer closes the current SPI batch there.
+typedef struct {
+  uint8_t reg;
+  uint8_t value;
+  uint8_t delayMs;
+} PAW3902RegWrite;
+
+// Counters for the last sequence run
+typedef struct {
+  uint16_t writes;       // register writes issued
+  uint16_t transactions; // bus transactions opened
+  uint32_t waitMicros;   // settle delays; tSWW gaps are left to the bus
+} PAW3902SequenceStats;
+
+// Light modes, also the index into the per-mode tables below
+#define bright        0
+#define lowlight      1
+#define superlowlight 2
+
+#define PAW3902_tSWW  11 // us, minimum time between write commands
+#define PAW3902_tSRAD  2 // us, read address to data delay
+#define PAW3902_tSRR   1 // us, minimum time after a read before the next command
+
+// Gaps between commands are the bus's job: it stamps the end of each command
+// and, before the next, waits only for what is left of tSWW (after a write)
+// or tSRR (after a read). 0 waits the full gap every time.
+#ifndef PAW3902_DEADLINE_GAPS
+#define PAW3902_DEADLINE_GAPS 1
+#endif
+
+// Microseconds still owed of a gap that began at micros() reading start. A
+// 1 us clock can read up to 1 us ahead of real time, so that much of the
+// elapsed time is not counted; with nothing in between this waits the full gap.
+static inline uint32_t paw3902GapRemaining(uint32_t start, uint32_t now, uint8_t gap)
+{
+#if PAW3902_DEADLINE_GAPS
+  uint32_t elapsed = now - start;
+  elapsed = elapsed ? elapsed - 1 : 0;
+  return elapsed < gap ? gap - elapsed : 0;
+#else
+  (void)start; (void)now;
+  return gap;
+#endif
+}
+
+#ifdef __cplusplus
+#define PAW3902_TABLE constexpr
+#else
+#define PAW3902_TABLE static const
+#endif
+
+#define PAW3902_TABLE_LENGTH(table) ((uint8_t)(sizeof(table) / sizeof((table)[0])))
+
+// Performance optimization registers for the three different modes
+PAW3902_TABLE PAW3902RegWrite initBrightTable[] = {
+  {0x7F, 0x00,  0},
+  {0x55, 0x01,  0},
+  {0x50, 0x07,  0},
+  {0x7F, 0x0E,  0},
+  {0x43, 0x10,  0},
+  {0x48, 0x02,  0},
+  {0x7F, 0x00,  0},
+  {0x51, 0x7B,  0},
+  {0x50, 0x00,  0},
+  {0x55, 0x00,  0},
+  {0x7F, 0x00,  0},
+
+  {0x61, 0xAD,  0},
+  {0x7F, 0x03,  0},
+  {0x40, 0x00,  0},
+  {0x7F, 0x05,  0},
+  {0x41, 0xB3,  0},
+  {0x43, 0xF1,  0},
+  {0x45, 0x14,  0},
+  {0x5F, 0x34,  0},
+  {0x7B, 0x08,  0},
+  {0x5E, 0x34,  0},
+  {0x5B, 0x32,  0},
+  {0x45, 0x17,  0},
+  {0x70, 0xE5,  0},
+  {0x71, 0xE5,  0},
+  {0x7F, 0x06,  0},
+  {0x44, 0x1B,  0},
+  {0x40, 0xBF,  0},
+  {0x4E, 0x3F,  0},
+  {0x7F, 0x08,  0},
+  {0x66, 0x44,  0},
+  {0x65, 0x20,  0},
+  {0x6A, 0x3A,  0},
+  {0x61, 0x05,  0},
+  {0x62, 0x05,  0},
+  {0x7F, 0x09,  0},
+  {0x4F, 0xAF,  0},
+  {0x48, 0x80,  0},
+  {0x49, 0x80,  0},
+  {0x57, 0x77,  0},
+  {0x5F, 0x40,  0},
+  {0x60, 0x78,  0},
+  {0x61, 0x78,  0},
+  {0x62, 0x08,  0},
+  {0x63, 0x50,  0},
+  {0x7F, 0x0A,  0},
+  {0x45, 0x60,  0},
+  {0x7F, 0x00,  0},
+  {0x4D, 0x11,  0},
+  {0x55, 0x80,  0},
+  {0x74, 0x21,  0},
+  {0x75, 0x1F,  0},
+  {0x4A, 0x78,  0},
+  {0x4B, 0x78,  0},
+  {0x44, 0x08,  0},
+  {0x45, 0x50,  0},
+  {0x64, 0xFE,  0},
+  {0x65, 0x1F,  0},
+  {0x72, 0x0A,  0},
+  {0x73, 0x00,  0},
+  {0x7F, 0x14,  0},
+  {0x44, 0x84,  0},
+  {0x65, 0x47,  0},
+  {0x66, 0x18,  0},
+  {0x63, 0x70,  0},
+  {0x6F, 0x2C,  0},
+  {0x7F, 0x15,  0},
+  {0x48, 0x48,  0},
+  {0x7F, 0x07,  0},
+  {0x41, 0x0D,  0},
+  {0x43, 0x14,  0},
+  {0x4B, 0x0E,  0},
+  {0x45, 0x0F,  0},
+  {0x44, 0x42,  0},
+  {0x4C, 0x80,  0},
+  {0x7F, 0x10,  0},
+  {0x5B, 0x03,  0},
+  {0x7F, 0x07,  0},
+  {0x40, 0x41, 10},
+
+  {0x7F, 0x00,  0},
+  {0x32, 0x00,  0},
+  {0x7F, 0x07,  0},
+  {0x40, 0x40,  0},
+  {0x7F, 0x06,  0},
+  {0x68, 0x70,  0},
+  {0x69, 0x01,  0},
+  {0x7F, 0x0D,  0},
+  {0x48, 0xC0,  0},
+  {0x6F, 0xD5,  0},
+  {0x7F, 0x00,  0},
+  {0x5B, 0xA0,  0},
+  {0x4E, 0xA8,  0},
+  {0x5A, 0x50,  0},
+  {0x40, 0x80,  0},
+  {0x73, 0x1F, 10},
+
+  {0x73, 0x00,  0}
+};
+
+
+PAW3902_TABLE PAW3902RegWrite initLowLightTable[] = {
+  {0x7F, 0x00,  0},
+  {0x55, 0x01,  0},
+  {0x50, 0x07,  0},
+  {0x7F, 0x0E,  0},
+  {0x43, 0x10,  0},
+  {0x48, 0x02,  0},
+  {0x7F, 0x00,  0},
+  {0x51, 0x7B,  0},
+  {0x50, 0x00,  0},
+  {0x55, 0x00,  0},
+  {0x7F, 0x00,  0},
+
+  {0x61, 0xAD,  0},
+  {0x7F, 0x03,  0},
+  {0x40, 0x00,  0},
+  {0x7F, 0x05,  0},
+  {0x41, 0xB3,  0},
+  {0x43, 0xF1,  0},
+  {0x45, 0x14,  0},
+  {0x5F, 0x34,  0},
+  {0x7B, 0x08,  0},
+  {0x5E, 0x34,  0},
+  {0x5B, 0x65,  0},
+  {0x6D, 0x65,  0},
+  {0x45, 0x17,  0},
+  {0x70, 0xE5,  0},
+  {0x71, 0xE5,  0},
+  {0x7F, 0x06,  0},
+  {0x44, 0x1B,  0},
+  {0x40, 0xBF,  0},
+  {0x4E, 0x3F,  0},
+  {0x7F, 0x08,  0},
+  {0x66, 0x44,  0},
+  {0x65, 0x20,  0},
+  {0x6A, 0x3A,  0},
+  {0x61, 0x05,  0},
+  {0x62, 0x05,  0},
+  {0x7F, 0x09,  0},
+  {0x4F, 0xAF,  0},
+  {0x48, 0x80,  0},
+  {0x49, 0x80,  0},
+  {0x57, 0x77,  0},
+  {0x5F, 0x40,  0},
+  {0x60, 0x78,  0},
+  {0x61, 0x78,  0},
+  {0x62, 0x08,  0},
+  {0x63, 0x50,  0},
+  {0x7F, 0x0A,  0},
+  {0x45, 0x60,  0},
+  {0x7F, 0x00,  0},
+  {0x4D, 0x11,  0},
+  {0x55, 0x80,  0},
+  {0x74, 0x21,  0},
+  {0x75, 0x1F,  0},
+  {0x4A, 0x78,  0},
+  {0x4B, 0x78,  0},
+  {0x44, 0x08,  0},
+  {0x45, 0x50,  0},
+  {0x64, 0xFE,  0},
+  {0x65, 0x1F,  0},
+  {0x72, 0x0A,  0},
+  {0x73, 0x00,  0},
+  {0x7F, 0x14,  0},
+  {0x44, 0x84,  0},
+  {0x65, 0x67,  0},
+  {0x66, 0x18,  0},
+  {0x63, 0x70,  0},
+  {0x6F, 0x2C,  0},
+  {0x7F, 0x15,  0},
+  {0x48, 0x48,  0},
+  {0x7F, 0x07,  0},
+  {0x41, 0x0D,  0},
+  {0x43, 0x14,  0},
+  {0x4B, 0x0E,  0},
+  {0x45, 0x0F,  0},
+  {0x44, 0x42,  0},
+  {0x4C, 0x80,  0},
+  {0x7F, 0x10,  0},
+  {0x5B, 0x03,  0},
+  {0x7F, 0x07,  0},
+  {0x40, 0x41, 10},
+
+  {0x7F, 0x00,  0},
+  {0x32, 0x00,  0},
+  {0x7F, 0x07,  0},
+  {0x40, 0x40,  0},
+  {0x7F, 0x06,  0},
+  {0x68, 0x70,  0},
+  {0x69, 0x01,  0},
+  {0x7F, 0x0D,  0},
+  {0x48, 0xC0,  0},
+  {0x6F, 0xD5,  0},
+  {0x7F, 0x00,  0},
+  {0x5B, 0xA0,  0},
+  {0x4E, 0xA8,  0},
+  {0x5A, 0x50,  0},
+  {0x40, 0x80,  0},
+  {0x73, 0x1F, 10},
+
+  {0x73, 0x00,  0}
+};
+
+
+PAW3902_TABLE PAW3902RegWrite initSuperLowLightTable[] = {
+  {0x7F, 0x00,  0},
+  {0x55, 0x01,  0},
+  {0x50, 0x07,  0},
+  {0x7F, 0x0E,  0},
+  {0x43, 0x10,  0},
+  {0x48, 0x04,  0},
+  {0x7F, 0x00,  0},
+  {0x51, 0x7B,  0},
+  {0x50, 0x00,  0},
+  {0x55, 0x00,  0},
+  {0x7F, 0x00,  0},
+
+  {0x61, 0xAD,  0},
+  {0x7F, 0x03,  0},
+  {0x40, 0x00,  0},
+  {0x7F, 0x05,  0},
+  {0x41, 0xB3,  0},
+  {0x43, 0xF1,  0},
+  {0x45, 0x14,  0},
+  {0x5F, 0x34,  0},
+  {0x7B, 0x08,  0},
+  {0x5E, 0x34,  0},
+  {0x5B, 0x32,  0},
+  {0x6D, 0x32,  0},
+  {0x45, 0x17,  0},
+  {0x70, 0xE5,  0},
+  {0x71, 0xE5,  0},
+  {0x7F, 0x06,  0},
+  {0x44, 0x1B,  0},
+  {0x40, 0xBF,  0},
+  {0x4E, 0x3F,  0},
+  {0x7F, 0x08,  0},
+  {0x66, 0x44,  0},
+  {0x65, 0x20,  0},
+  {0x6A, 0x3A,  0},
+  {0x61, 0x05,  0},
+  {0x62, 0x05,  0},
+  {0x7F, 0x09,  0},
+  {0x4F, 0xAF,  0},
+  {0x48, 0x80,  0},
+  {0x49, 0x80,  0},
+  {0x57, 0x77,  0},
+  {0x5F, 0x40,  0},
+  {0x60, 0x78,  0},
+  {0x61, 0x78,  0},
+  {0x62, 0x08,  0},
+  {0x63, 0x50,  0},
+  {0x7F, 0x0A,  0},
+  {0x45, 0x60,  0},
+  {0x7F, 0x00,  0},
+  {0x4D, 0x11,  0},
+  {0x55, 0x80,  0},
+  {0x74, 0x21,  0},
+  {0x75, 0x1F,  0},
+  {0x4A, 0x78,  0},
+  {0x4B, 0x78,  0},
+  {0x44, 0x08,  0},
+  {0x45, 0x50,  0},
+  {0x64, 0xCE,  0},
+  {0x65, 0x0B,  0},
+  {0x72, 0x0A,  0},
+  {0x73, 0x00,  0},
+  {0x7F, 0x14,  0},
+  {0x44, 0x84,  0},
+  {0x65, 0x67,  0},
+  {0x66, 0x18,  0},
+  {0x63, 0x70,  0},
+  {0x6F, 0x2C,  0},
+  {0x7F, 0x15,  0},
+  {0x48, 0x48,  0},
+  {0x7F, 0x07,  0},
+  {0x41, 0x0D,  0},
+  {0x43, 0x14,  0},
+  {0x4B, 0x0E,  0},
+  {0x45, 0x0F,  0},
+  {0x44, 0x42,  0},
+  {0x4C, 0x80,  0},
+  {0x7F, 0x10,  0},
+  {0x5B, 0x02,  0},
+  {0x7F, 0x07,  0},
+  {0x40, 0x41, 25},
+
+  {0x7F, 0x00,  0},
+  {0x32, 0x44,  0},
+  {0x7F, 0x07,  0},
+  {0x40, 0x40,  0},
+  {0x7F, 0x06,  0},
+  {0x68, 0x40,  0},
+  {0x69, 0x02,  0},
+  {0x7F, 0x0D,  0},
+  {0x48, 0xC0,  0},
+  {0x6F, 0xD5,  0},
+  {0x7F, 0x00,  0},
+  {0x5B, 0xA0,  0},
+  {0x4E, 0xA8,  0},
+  {0x5A, 0x50,  0},
+  {0x40, 0x80,  0},
+  {0x73, 0x0B, 25},
+
+  {0x73, 0x00,  0}
+};
+
+
+// Registers whose value depends on the light mode, {bank, reg, {bright, lowlight, superlowlight}}.
+// switchMode() writes only the ones that differ between the current and target mode and then
+// restarts the pipeline the way the full sequences end. The bright sequence never writes bank
+// 0x05 register 0x6D, so its bright value is the power-on default latched in begin().
+typedef struct {
+  uint8_t bank;
+  uint8_t reg;
+  uint8_t value[3];
+} PAW3902ModeReg;
+
+PAW3902_TABLE PAW3902ModeReg modeRegisterTable[] = {
+  {0x0E, 0x48, {0x02, 0x02, 0x04}}, // protected bank, unlocked through bank 0
+  {0x05, 0x5B, {0x32, 0x65, 0x32}},
+  {0x05, 0x6D, {0x00, 0x65, 0x32}},
+  {0x00, 0x64, {0xFE, 0xFE, 0xCE}},
+  {0x00, 0x65, {0x1F, 0x1F, 0x0B}},
+  {0x14, 0x65, {0x47, 0x67, 0x67}},
+  {0x10, 0x5B, {0x03, 0x03, 0x02}},
+  {0x06, 0x68, {0x70, 0x70, 0x40}},
+  {0x06, 0x69, {0x01, 0x01, 0x02}}
+};
+
+// Values used by the pipeline restart at the end of each sequence
+PAW3902_TABLE uint8_t modeReg32[3]   = {0x00, 0x00, 0x44};
+PAW3902_TABLE uint8_t modeReg73[3]   = {0x1F, 0x1F, 0x0B};
+PAW3902_TABLE uint8_t modeSettleMs[3] = {10, 10, 25};
+
+
+// Frame capture entry/exit (caller selects lowlight first, see enterFrameCaptureMode())
+PAW3902_TABLE PAW3902RegWrite enterFrameCaptureTable[] = {
+  {0x7F, 0x07,  0},
+  {0x41, 0x1D,  0},
+  {0x4C, 0x00,  0},
+  {0x7F, 0x08,  0},
+  {0x6A, 0x38,  0},
+  {0x7F, 0x00,  0},
+  {0x55, 0x04,  0},
+  {0x40, 0x80,  0},
+  {0x4D, 0x11,  1}
+};
+
+
+PAW3902_TABLE PAW3902RegWrite exitFrameCaptureTable[] = {
+  {0x7F, 0x00,  0},
+  {0x4D, 0x11,  0},
+  {0x40, 0x80,  0},
+  {0x55, 0x80,  0},
+  {0x7F, 0x08,  0},
+  {0x6A, 0x18,  0},
+  {0x7F, 0x07,  0},
+  {0x41, 0x0D,  0},
+  {0x4C, 0x80,  0},
+  {0x7F, 0x00,  0}
+};
+
+#endif //__PAW3902TABLES_H
@@ -0,0 +1,202 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __POWERMANAGER_H
+#define __POWERMANAGER_H
+
+#include <stdint.h>
+#include <string.h>
+#include "PAW3902Sample.h"
+
+// Motion-triggered duty cycling of one sensor. The app hands every sample to
+// powerSample() and calls powerPoll() once per pass, which answers with what
+// to do to the sensor:
+//
+//   POWER_SHUTDOWN  no motion for idleMicros: call shutdown()
+//   POWER_WAKE      shut down for wakeMicros, or powerTrigger() was called
+//                   from another wake source: call wake(), then powerAwake()
+//
+// After a scheduled wake the sensor gets listenMicros to see motion before it
+// goes back down; after a triggered one it gets the full idleMicros.
+//
+// Wake latency is counted two ways: wake() itself (the poll that asked for it
+// to powerAwake()), and the wake request to the first sample after it. Samples
+// lost per wake are that second time over the interval seen between samples
+// while moving. A scheduled wake cannot know when the motion that it finds
+// began, so for those the count is a lower bound.
+
+#define POWER_HOLD     0 // powerPoll(): leave the sensor as it is
+#define POWER_SHUTDOWN 1
+#define POWER_WAKE     2
+
+#define POWER_AWAKE  0 // PowerManager.state
+#define POWER_ASLEEP 1
+#define POWER_WAKING 2 // woken, no sample since
+
+typedef struct {
+  uint32_t idleMicros;    // no motion this long: shut down, 0 = never
+  uint32_t wakeMicros;    // shut down this long: wake for a look, 0 = only on powerTrigger()
+  uint32_t listenMicros;  // awake this long after a scheduled wake without motion: back down
+  uint16_t minCounts;     // |deltaX| + |deltaY| a valid sample needs to count as motion
+} PowerConfig;
+
+typedef struct {
+  uint32_t awakeMicros;   // sensor powered, waking included
+  uint32_t asleepMicros;
+  uint16_t awakePermille; // of the window
+  uint16_t wakes;
+  uint16_t triggered;     // wakes from powerTrigger()
+  uint16_t quiet;         // scheduled wakes that found no motion
+  uint32_t maxWakeMicros; // longest wake() call
+  uint32_t maxDataMicros; // longest wake request to first sample
+  uint32_t meanDataMicros;
+  uint32_t samplesLost;   // estimated, see above
+} PowerStats;
+
+typedef struct {
+  PowerConfig config;
+  uint8_t  state;
+  uint8_t  listening;         // scheduled wake, no motion yet
+  volatile uint8_t  trigger;  // powerTrigger() since the last poll
+  volatile uint32_t triggerAt;
+  uint32_t stateSince;        // us, entered the current state
+  uint32_t lastMotion;        // us, or the end of the last wake
+  uint32_t lastSample;
+  uint32_t wakeRequest;       // us, when the current wake was asked for
+  uint32_t interval;          // us between samples while moving, smoothed over 8
+  uint32_t accountedAt;       // us, awake/asleep time counted up to here
+  uint32_t dataMicros;        // summed wake request to first sample, for the mean
+  uint16_t dataWakes;         // wakes that got a sample
+  PowerStats stats;           // since the last powerTake()
+} PowerManager;
+
+// Off after 2 s still, a look every 500 ms for 40 ms (five samples at the
+// fastest frame rate) while off
+static const PowerConfig powerDefaults = { 2000000, 500000, 40000, 2 };
+
+// config NULL for powerDefaults
+static inline void powerInit(PowerManager * pm, const PowerConfig * config, uint32_t now)
+{
+  memset(pm, 0, sizeof(PowerManager));
+  pm->config = config ? *config : powerDefaults;
+  pm->state = POWER_AWAKE;
+  pm->stateSince = pm->lastMotion = pm->lastSample = pm->accountedAt = now;
+}
+
+static inline void powerAccount(PowerManager * pm, uint32_t now)
+{
+  uint32_t span = now - pm->accountedAt;
+  if(pm->state == POWER_ASLEEP) pm->stats.asleepMicros += span;
+  else pm->stats.awakeMicros += span;
+  pm->accountedAt = now;
+}
+
+static inline void powerEnter(PowerManager * pm, uint8_t state, uint32_t now)
+{
+  powerAccount(pm, now);
+  pm->state = state;
+  pm->stateSince = now;
+}
+
+// From any context, e.g. an accelerometer or button interrupt
+static inline void powerTrigger(PowerManager * pm, uint32_t now)
+{
+  if(pm->trigger) return;
+  pm->triggerAt = now;
+  pm->trigger = 1;
+}
+
+// Every sample the sensor delivers
+static inline void powerSample(PowerManager * pm, const PAW3902Sample * sample)
+{
+  uint32_t dt = sample->timestamp - pm->lastSample;
+  pm->lastSample = sample->timestamp;
+
+  if(pm->state == POWER_WAKING)
+  {
+    uint32_t latency = sample->timestamp - pm->wakeRequest;
+    if(latency > pm->stats.maxDataMicros) pm->stats.maxDataMicros = latency;
+    pm->dataMicros += latency;
+    pm->dataWakes++;
+    if(pm->interval) pm->stats.samplesLost += latency / pm->interval;
+    pm->state = POWER_AWAKE;
+    dt = 0; // spans the shutdown, not an interval between samples
+  }
+
+  int32_t counts = (sample->deltaX < 0 ? -sample->deltaX : sample->deltaX) + (sample->deltaY < 0 ? -sample->deltaY : sample->deltaY);
+  if(!sample->valid || counts < pm->config.minCounts) return;
+
+  // Only intervals between consecutive moving samples say how fast they come
+  if(dt && sample->timestamp - pm->lastMotion == dt)
+    pm->interval = pm->interval ? pm->interval + (int32_t)(dt - pm->interval) / 8 : dt;
+  pm->lastMotion = sample->timestamp;
+  pm->listening = 0;
+}
+
+// Once per pass of the app's loop
+static inline uint8_t powerPoll(PowerManager * pm, uint32_t now)
+{
+  const PowerConfig * c = &pm->config;
+  if(pm->state == POWER_ASLEEP)
+  {
+    uint8_t triggered = pm->trigger;
+    if(!triggered && (!c->wakeMicros || now - pm->stateSince < c->wakeMicros)) return POWER_HOLD;
+    pm->wakeRequest = triggered ? pm->triggerAt : now;
+    pm->trigger = 0;
+    pm->listening = !triggered;
+    pm->stats.wakes++;
+    pm->stats.triggered += triggered;
+    powerEnter(pm, POWER_WAKING, now);
+    return POWER_WAKE;
+  }
+
+  pm->trigger = 0; // awake already
+  if(!c->idleMicros || now - pm->lastMotion < (pm->listening ? c->listenMicros : c->idleMicros)) return POWER_HOLD;
+  pm->stats.quiet += pm->listening;
+  pm->listening = 0;
+  powerEnter(pm, POWER_ASLEEP, now);
+  return POWER_SHUTDOWN;
+}
+
+// After wake() returns; idle and listen time count from here
+static inline void powerAwake(PowerManager * pm, uint32_t now)
+{
+  uint32_t wake = now - pm->stateSince;
+  if(wake > pm->stats.maxWakeMicros) pm->stats.maxWakeMicros = wake;
+  pm->lastMotion = now;
+}
+
+// Counters since the last call, then start a new window
+static inline void powerTake(PowerManager * pm, uint32_t now, PowerStats * stats)
+{
+  powerAccount(pm, now);
+  uint32_t awake = pm->stats.awakeMicros, asleep = pm->stats.asleepMicros;
+  while(awake > 4000000 || asleep > 4000000) { awake >>= 1; asleep >>= 1; } // awake * 1000 in 32 bits
+  pm->stats.awakePermille = awake + asleep ? (uint16_t)(awake * 1000 / (awake + asleep)) : 1000;
+  pm->stats.meanDataMicros = pm->dataWakes ? pm->dataMicros / pm->dataWakes : 0;
+  *stats = pm->stats;
+  memset(&pm->stats, 0, sizeof(PowerStats));
+  pm->dataMicros = 0;
+  pm->dataWakes = 0;
+}
+
+#endif //__POWERMANAGER_H
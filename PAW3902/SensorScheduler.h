@@ -0,0 +1,206 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __SENSORSCHEDULER_H
+#define __SENSORSCHEDULER_H
+
+#include <stdint.h>
+#include <string.h>
+#include "PAW3902Sample.h"
+
+// Services several sensors sharing one SPI bus from a single context. Each
+// sensor's motion interrupt only calls sensorSchedRaise(), which stamps when
+// the sensor first asked; the loop then asks sensorSchedNext() which sensor
+// to read, reads its burst and hands the sample to sensorSchedDone(). Only
+// one context ever touches the bus, so the drivers need no locking.
+//
+// Raise and done keep separate counters (raised by the interrupt, serviced
+// by the loop), as MotionRing does, so nothing needs masking. Interrupts that
+// arrive while a sensor is already waiting are coalesced: the burst collects
+// all the motion since the last read anyway.
+//
+// Samples carry the time the burst was read, when the sensor latched its
+// counts, and the sensor's index. sensorSchedPositionAt() interpolates each
+// sensor's summed displacement to a common instant, so readings from sensors
+// serviced at different times can be combined.
+
+#ifndef SENSOR_SCHED_MAX
+#define SENSOR_SCHED_MAX 4 // sensors per scheduler
+#endif
+
+#define SENSOR_SCHED_ROUND_ROBIN 0 // next waiting sensor after the last one read
+#define SENSOR_SCHED_PRIORITY    1 // highest priority waiting sensor, ties round robin
+#define SENSOR_SCHED_NONE     0xFF // nothing waiting
+
+typedef struct {
+  uint32_t samples;          // bursts read
+  uint32_t samplesPerSecond;
+  uint32_t maxAgeMicros;     // worst interrupt to burst read
+  uint32_t coalesced;        // interrupts folded into an earlier one
+} SensorStats;
+
+typedef struct {
+  volatile uint16_t raised;   // motion interrupts, interrupt only
+  volatile uint32_t raisedAt; // us, first interrupt not yet claimed
+  uint16_t serviced;          // interrupts covered by a read, loop only
+  volatile uint16_t claimed;  // raised as of sensorSchedNext(), loop only
+  uint32_t claimedAt;         // raisedAt as of sensorSchedNext()
+  uint8_t  priority;          // higher goes first under SENSOR_SCHED_PRIORITY
+  SensorStats stats;          // since the last sensorSchedTake()
+  int32_t  x[2], y[2];        // summed displacement at the last two reads
+  uint32_t t[2];              // us, when they were read
+  uint32_t reads;
+} SensorSlot;
+
+typedef struct {
+  SensorSlot sensors[SENSOR_SCHED_MAX];
+  uint8_t  count;
+  uint8_t  policy;
+  uint8_t  last;              // sensor read last, where round robin resumes
+  uint32_t windowStart;       // us, start of the stats window
+} SensorScheduler;
+
+static inline void sensorSchedInit(SensorScheduler * sched, uint8_t count, uint8_t policy, uint32_t now)
+{
+  memset(sched, 0, sizeof(SensorScheduler));
+  sched->count = count > SENSOR_SCHED_MAX ? SENSOR_SCHED_MAX : count;
+  sched->policy = policy;
+  sched->last = sched->count - 1;
+  sched->windowStart = now;
+}
+
+// From the sensor's motion interrupt
+static inline void sensorSchedRaise(SensorScheduler * sched, uint8_t sensor, uint32_t now)
+{
+  SensorSlot * s = &sched->sensors[sensor];
+  uint16_t raised = s->raised;
+  if(raised == s->claimed) s->raisedAt = now; // nothing newer waiting
+  __asm__ __volatile__("" ::: "memory");
+  s->raised = raised + 1;
+}
+
+// Sensor to read next, or SENSOR_SCHED_NONE. Interrupts raised after this
+// call stay pending for the following one.
+static inline uint8_t sensorSchedNext(SensorScheduler * sched)
+{
+  uint8_t best = SENSOR_SCHED_NONE;
+  for(uint8_t ii = 1; ii <= sched->count; ii++)
+  {
+    uint8_t sensor = (sched->last + ii) % sched->count;
+    SensorSlot * s = &sched->sensors[sensor];
+    if(s->raised == s->serviced) continue;
+    if(best == SENSOR_SCHED_NONE) best = sensor;
+    if(sched->policy == SENSOR_SCHED_ROUND_ROBIN) break;
+    if(s->priority > sched->sensors[best].priority) best = sensor;
+  }
+  if(best != SENSOR_SCHED_NONE)
+  {
+    SensorSlot * s = &sched->sensors[best];
+    s->claimedAt = s->raisedAt; // before claiming, so an interrupt in between can't restamp it
+    __asm__ __volatile__("" ::: "memory");
+    s->claimed = s->raised;
+  }
+  return best;
+}
+
+// 1 if any sensor has raised an interrupt not yet covered by a read, for a
+// loop deciding whether it may sleep
+static inline uint8_t sensorSchedPending(const SensorScheduler * sched)
+{
+  for(uint8_t ii = 0; ii < sched->count; ii++)
+    if(sched->sensors[ii].raised != sched->sensors[ii].serviced) return 1;
+  return 0;
+}
+
+// After reading the burst of the sensor sensorSchedNext() returned; tags the
+// sample with the sensor's index
+static inline void sensorSchedDone(SensorScheduler * sched, uint8_t sensor, PAW3902Sample * sample)
+{
+  SensorSlot * s = &sched->sensors[sensor];
+  uint32_t age = sample->timestamp - s->claimedAt;
+  uint16_t covered = (uint16_t)(s->claimed - s->serviced);
+
+  if(age > s->stats.maxAgeMicros) s->stats.maxAgeMicros = age;
+  s->stats.coalesced += covered - 1;
+  s->stats.samples++;
+  __asm__ __volatile__("" ::: "memory");
+  s->serviced = s->claimed;
+
+  s->x[0] = s->x[1];
+  s->y[0] = s->y[1];
+  s->t[0] = s->t[1];
+  s->x[1] += sample->deltaX;
+  s->y[1] += sample->deltaY;
+  s->t[1] = sample->timestamp;
+  s->reads++;
+
+  sample->sensor = sensor;
+  sched->last = sensor;
+}
+
+// Summed displacement of a sensor at time t, interpolated between its last
+// two reads and held outside them. Returns 0 before the sensor's first read.
+static inline uint8_t sensorSchedPositionAt(const SensorScheduler * sched, uint8_t sensor, uint32_t t, int32_t * x, int32_t * y)
+{
+  const SensorSlot * s = &sched->sensors[sensor];
+  if(s->reads == 0) return 0;
+  int32_t span = (int32_t)(s->t[1] - s->t[0]);
+  int32_t into = (int32_t)(t - s->t[0]);
+  if(s->reads < 2 || span <= 0 || into >= span)
+  {
+    *x = s->x[1];
+    *y = s->y[1];
+  }
+  else if(into <= 0)
+  {
+    *x = s->x[0];
+    *y = s->y[0];
+  }
+  else
+  {
+    *x = s->x[0] + (int32_t)((int64_t)(s->x[1] - s->x[0]) * into / span);
+    *y = s->y[0] + (int32_t)((int64_t)(s->y[1] - s->y[0]) * into / span);
+  }
+  return 1;
+}
+
+// Per-sensor stats since the last call, and their aggregate in total (its
+// maxAgeMicros is the worst of any sensor); starts a new window
+static inline void sensorSchedTake(SensorScheduler * sched, uint32_t now, SensorStats * perSensor, SensorStats * total)
+{
+  uint32_t window = now - sched->windowStart;
+  memset(total, 0, sizeof(SensorStats));
+  for(uint8_t ii = 0; ii < sched->count; ii++)
+  {
+    SensorStats * s = &sched->sensors[ii].stats;
+    s->samplesPerSecond = window ? (uint32_t)(s->samples * 1000000ULL / window) : 0;
+    if(perSensor) perSensor[ii] = *s;
+    total->samples += s->samples;
+    total->samplesPerSecond += s->samplesPerSecond;
+    total->coalesced += s->coalesced;
+    if(s->maxAgeMicros > total->maxAgeMicros) total->maxAgeMicros = s->maxAgeMicros;
+    memset(s, 0, sizeof(SensorStats));
+  }
+  sched->windowStart = now;
+}
+
+#endif //__SENSORSCHEDULER_H
@@ -0,0 +1,160 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __TASKSCHEDULER_H
+#define __TASKSCHEDULER_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Cooperative scheduling of the app's periodic work. Each task is released
+// every periodMicros and should finish within deadlineMicros of its release.
+// The loop asks taskNext() for the released task with the earliest deadline,
+// runs it to completion and reports the run with taskDone(), as with
+// sensorSchedNext()/sensorSchedDone(). Nothing is preempted, so the reads that
+// cannot wait stay in the motion interrupt; a task that runs long shows up
+// as misses of the tasks it held up.
+//
+// A task finishing a whole period or more late skips the releases it missed
+// rather than running back to back to catch up, and counts them.
+
+#ifndef TASK_MAX
+#define TASK_MAX 8 // tasks per scheduler
+#endif
+
+#define TASK_NONE 0xFF // nothing released
+
+typedef void (*TaskFunction)(void);
+
+typedef struct {
+  uint32_t runs;
+  uint32_t misses;            // finished past the deadline
+  uint32_t skipped;           // releases dropped after running late
+  uint32_t maxRunMicros;      // longest single run
+  uint32_t maxResponseMicros; // worst release to finish
+  uint32_t busyMicros;        // time spent running
+} TaskStats;
+
+typedef struct {
+  const char * name;
+  TaskFunction run;
+  uint32_t periodMicros;
+  uint32_t deadlineMicros;    // after the release
+  uint32_t release;           // us, current or next release
+  TaskStats stats;            // since the last taskTake()
+} Task;
+
+typedef struct {
+  Task     tasks[TASK_MAX];
+  uint8_t  count;
+  uint32_t windowStart;       // us, start of the stats window
+} TaskScheduler;
+
+static inline void taskInit(TaskScheduler * sched, uint32_t now)
+{
+  memset(sched, 0, sizeof(TaskScheduler));
+  sched->windowStart = now;
+}
+
+// First release at now; a deadline of 0 is the period. Returns the task's
+// index, or TASK_NONE if the scheduler is full.
+static inline uint8_t taskAdd(TaskScheduler * sched, const char * name, TaskFunction run, uint32_t periodMicros,
+                              uint32_t deadlineMicros, uint32_t now)
+{
+  if(sched->count == TASK_MAX) return TASK_NONE;
+  Task * t = &sched->tasks[sched->count];
+  t->name = name;
+  t->run = run;
+  t->periodMicros = periodMicros;
+  t->deadlineMicros = deadlineMicros ? deadlineMicros : periodMicros;
+  t->release = now;
+  return sched->count++;
+}
+
+// Released task with the earliest deadline, ties to the first added, or TASK_NONE
+static inline uint8_t taskNext(const TaskScheduler * sched, uint32_t now)
+{
+  uint8_t best = TASK_NONE;
+  for(uint8_t ii = 0; ii < sched->count; ii++)
+  {
+    const Task * t = &sched->tasks[ii];
+    if((int32_t)(now - t->release) < 0) continue;
+    if(best == TASK_NONE) best = ii;
+    else
+    {
+      const Task * b = &sched->tasks[best];
+      if((int32_t)((t->release + t->deadlineMicros) - (b->release + b->deadlineMicros)) < 0) best = ii;
+    }
+  }
+  return best;
+}
+
+// After running the task taskNext() returned, from start to end
+static inline void taskDone(TaskScheduler * sched, uint8_t task, uint32_t start, uint32_t end)
+{
+  Task * t = &sched->tasks[task];
+  uint32_t run = end - start, response = end - t->release;
+  t->stats.runs++;
+  t->stats.busyMicros += run;
+  if(run > t->stats.maxRunMicros) t->stats.maxRunMicros = run;
+  if(response > t->stats.maxResponseMicros) t->stats.maxResponseMicros = response;
+  if(response > t->deadlineMicros) t->stats.misses++;
+
+  t->release += t->periodMicros;
+  while((int32_t)(end - t->release) >= (int32_t)t->periodMicros)
+  {
+    t->release += t->periodMicros;
+    t->stats.skipped++;
+  }
+}
+
+// Microseconds until the next release, 0 if a task is released; how long the
+// loop may sleep or do background work
+static inline uint32_t taskIdleMicros(const TaskScheduler * sched, uint32_t now)
+{
+  uint32_t idle = UINT32_MAX;
+  for(uint8_t ii = 0; ii < sched->count; ii++)
+  {
+    int32_t until = (int32_t)(sched->tasks[ii].release - now);
+    if(until <= 0) return 0;
+    if((uint32_t)until < idle) idle = until;
+  }
+  return idle;
+}
+
+// Per-task stats since the last call and the share of the window spent in
+// tasks, in permille; starts a new window
+static inline uint16_t taskTake(TaskScheduler * sched, uint32_t now, TaskStats * perTask)
+{
+  uint32_t window = now - sched->windowStart, busy = 0;
+  for(uint8_t ii = 0; ii < sched->count; ii++)
+  {
+    TaskStats * s = &sched->tasks[ii].stats;
+    busy += s->busyMicros;
+    if(perTask) perTask[ii] = *s;
+    memset(s, 0, sizeof(TaskStats));
+  }
+  sched->windowStart = now;
+  return window ? (uint16_t)((uint64_t)busy * 1000 / window) : 0;
+}
+
+#endif //__TASKSCHEDULER_H
@@ -0,0 +1,191 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#include <stdint.h>
+#include "PAW3902Sample.h"
+
+// Binary telemetry framing for the console UART. Each packet is a type byte and
+// a little-endian payload, followed by a CRC-16/CCITT (poly 0x1021, init
+// 0xFFFF, sent high byte first), COBS encoded and terminated by a 0x00
+// delimiter. A receiver resynchronises at the next delimiter after any
+// corruption, and stray text on the same port fails the CRC and is dropped.
+//
+// The encoder streams: bytes are handed to the write callback a COBS block
+// (at most 254 data bytes) at a time, so packets of any length need only the
+// encoder's own block buffer.
+
+#define TELEMETRY_MOTION      0x01 // one PAW3902Sample, see telemetrySendMotion()
+#define TELEMETRY_MOTION_SIZE 15   // payload bytes including the type byte
+
+// Worst-case bytes on the wire for a payload of n bytes, CRC and delimiter included
+#define TELEMETRY_WIRE_SIZE(n) ((n) + 2 + ((n) + 2) / 254 + 2)
+
+typedef void (*TelemetryWrite)(const uint8_t * data, uint16_t length);
+
+typedef struct {
+  uint8_t  block[256]; // COBS code byte, up to 254 data bytes and the delimiter
+  uint8_t  length;     // bytes in block, code byte included
+  uint16_t crc;
+  TelemetryWrite write;
+} TelemetryEncoder;
+
+static inline uint16_t telemetryCrc(uint16_t crc, uint8_t data)
+{
+  static const uint16_t nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+  };
+  crc = (crc << 4) ^ nibble[(crc >> 12) ^ (data >> 4)];
+  crc = (crc << 4) ^ nibble[(crc >> 12) ^ (data & 0x0F)];
+  return crc;
+}
+
+static inline void telemetryInit(TelemetryEncoder * enc, TelemetryWrite write)
+{
+  enc->write = write;
+  enc->length = 1;
+  enc->crc = 0xFFFF;
+}
+
+// COBS stage, does not touch the CRC
+static inline void telemetryStuff(TelemetryEncoder * enc, uint8_t data)
+{
+  if(data == 0)
+  {
+    enc->block[0] = enc->length;
+    enc->write(enc->block, enc->length);
+    enc->length = 1;
+    return;
+  }
+  enc->block[enc->length++] = data;
+  if(enc->length == 255)
+  {
+    enc->block[0] = 255;
+    enc->write(enc->block, 255);
+    enc->length = 1;
+  }
+}
+
+static inline void telemetryBegin(TelemetryEncoder * enc, uint8_t type)
+{
+  enc->length = 1;
+  enc->crc = telemetryCrc(0xFFFF, type);
+  telemetryStuff(enc, type);
+}
+
+static inline void telemetryPut(TelemetryEncoder * enc, uint8_t data)
+{
+  enc->crc = telemetryCrc(enc->crc, data);
+  telemetryStuff(enc, data);
+}
+
+static inline void telemetryPut16(TelemetryEncoder * enc, uint16_t data)
+{
+  telemetryPut(enc, data & 0xFF);
+  telemetryPut(enc, data >> 8);
+}
+
+static inline void telemetryPut32(TelemetryEncoder * enc, uint32_t data)
+{
+  telemetryPut16(enc, data & 0xFFFF);
+  telemetryPut16(enc, data >> 16);
+}
+
+// Append the CRC, close the last block and send it with the delimiter
+static inline void telemetryEnd(TelemetryEncoder * enc)
+{
+  uint16_t crc = enc->crc;
+  telemetryStuff(enc, crc >> 8);
+  telemetryStuff(enc, crc & 0xFF);
+  enc->block[0] = enc->length;
+  enc->block[enc->length] = 0x00;
+  enc->write(enc->block, enc->length + 1);
+  enc->length = 1;
+}
+
+// 19 bytes on the wire per sample
+static inline void telemetrySendMotion(TelemetryEncoder * enc, const PAW3902Sample * sample, uint8_t seq)
+{
+  telemetryBegin(enc, TELEMETRY_MOTION);
+  telemetryPut(enc, seq);
+  telemetryPut32(enc, sample->timestamp);
+  telemetryPut16(enc, (uint16_t)sample->deltaX);
+  telemetryPut16(enc, (uint16_t)sample->deltaY);
+  telemetryPut16(enc, sample->Shutter);
+  telemetryPut(enc, sample->SQUAL);
+  telemetryPut(enc, sample->RawDataSum);
+  telemetryPut(enc, (uint8_t)(sample->sensor << 4 | sample->mode)); // sensor index in the high nibble
+  telemetryEnd(enc);
+}
+
+// Decode one packet received between delimiters into payload, which needs
+// room for the two CRC bytes as well. Returns the payload length without the
+// CRC, or 0 if the framing or CRC is bad.
+static inline uint16_t telemetryDecode(const uint8_t * in, uint16_t length, uint8_t * payload, uint16_t maxLength)
+{
+  uint16_t ii = 0, n = 0, crc = 0xFFFF;
+  while(ii < length)
+  {
+    uint8_t code = in[ii++];
+    if(code == 0 || ii + code - 1 > length) return 0;
+    for(uint8_t jj = 1; jj < code; jj++)
+    {
+      if(n == maxLength) return 0;
+      crc = telemetryCrc(crc, in[ii]);
+      payload[n++] = in[ii++];
+    }
+    if(code != 255 && ii < length)
+    {
+      if(n == maxLength) return 0;
+      crc = telemetryCrc(crc, 0);
+      payload[n++] = 0;
+    }
+  }
+  if(n < 3 || crc != 0) return 0; // CRC over the payload and its own CRC leaves zero
+  return n - 2;
+}
+
+static inline uint16_t telemetryGet16(const uint8_t * p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+static inline uint32_t telemetryGet32(const uint8_t * p) { return telemetryGet16(p) | ((uint32_t)telemetryGet16(p + 2) << 16); }
+
+static inline uint8_t telemetryGetMotion(const uint8_t * payload, uint16_t length, PAW3902Sample * sample, uint8_t * seq)
+{
+  if(length != TELEMETRY_MOTION_SIZE || payload[0] != TELEMETRY_MOTION) return 0;
+  *seq               = payload[1];
+  sample->timestamp  = telemetryGet32(payload + 2);
+  sample->deltaX     = (int16_t)telemetryGet16(payload + 6);
+  sample->deltaY     = (int16_t)telemetryGet16(payload + 8);
+  sample->Shutter    = telemetryGet16(payload + 10);
+  sample->SQUAL      = payload[12];
+  sample->RawDataSum = payload[13];
+  sample->mode       = payload[14] & 0x0F;
+  sample->sensor     = payload[14] >> 4;
+  sample->confidence = 255; // not sent, every input to lightModeRate() is
+  sample->valid      = 1;
+  return 1;
+}
+
+#endif //__TELEMETRY_H
@@ -0,0 +1,194 @@
+/* PAW3902 Optical Flow Sensor
+ * Copyright (c) 2019 Tlera Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __VELOCITYESTIMATOR_H
+#define __VELOCITYESTIMATOR_H
+
+#include <stdint.h>
+#include "PAW3902Sample.h"
+
+// Ground-plane velocity from burst samples: counts are scaled to millimetres
+// with the mounting height and the sensor's angle per count, then each axis
+// runs a constant-velocity Kalman filter (position, velocity). All arithmetic
+// is Q16 fixed point in 32 bits with 64-bit products and one 32-bit divide
+// per sample, so it needs no FPU and no 64-bit division.
+//
+// Units are millimetres, milliseconds and so m/s (= mm/ms) for velocity,
+// which keeps the covariances of a sensor between 0.1 and 30 m up well
+// inside Q16. Both axes see the same time steps and the same measurement
+// noise, so they share one covariance.
+//
+// The sample's confidence (lightModeRate() in LightModeController.h) scales
+// the measurement noise: countNoise applies at full confidence (255) and it
+// grows as 255 / confidence below that. Samples under minConfidence only
+// advance the prediction. A gap longer than maxGapMicros between
+// samples (no motion interrupt) restarts the filter at rest.
+//
+// The position state is kept relative to the measured track, which restarts
+// at every sample, so it never grows; only velocity is reported.
+
+#define VELOCITY_Q16(x) ((int32_t)((x) * 65536.0 + ((x) < 0 ? -0.5 : 0.5))) // constants only
+#define VELOCITY_ONE    VELOCITY_Q16(1)
+
+typedef struct {
+  uint32_t microradPerCount; // flow angle per count
+  int32_t  countNoise;       // Q16 counts per axis, measurement noise at full quality
+  uint8_t  minConfidence;
+  int32_t  accelNoise;       // Q16 m/s^2, random acceleration the filter allows for
+  int32_t  initVelocity;     // Q16 m/s, velocity uncertainty on a (re)start
+  uint32_t maxGapMicros;
+} VelocityConfig;
+
+typedef struct {
+  VelocityConfig config;
+  int32_t  mmPerCount;       // Q16, from the height
+  uint32_t accelQ32;         // accelNoise in mm/ms^2, Q32
+  int32_t  vx, vy;           // Q16 m/s, the estimate
+  int32_t  ex, ey;           // Q16 mm, position estimate less the measured track
+  int32_t  p00, p01, p11;    // Q16 covariance: mm^2, mm * m/s, (m/s)^2
+  uint32_t lastTimestamp;
+  uint8_t  started;
+  uint32_t updates;          // samples that corrected the estimate
+  uint32_t skipped;          // under minConfidence, predicted only
+  uint32_t restarts;
+} VelocityEstimator;
+
+// 1/500 rad per count, the scale commonly used for this sensor family;
+// calibrate by turning the sensor through a known angle over a textured
+// surface
+static const VelocityConfig velocityDefaults = {
+  2000, VELOCITY_Q16(0.5), 16, VELOCITY_Q16(5.0), VELOCITY_Q16(1.0), 100000
+};
+
+static inline int32_t velocityMul(int32_t a, int32_t b) // Q16 product, rounded
+{
+  return (int32_t)(((int64_t)a * b + 0x8000) >> 16);
+}
+
+static inline int32_t velocityClamp(int64_t x)
+{
+  return x > INT32_MAX ? INT32_MAX : x < -INT32_MAX ? -INT32_MAX : (int32_t)x;
+}
+
+// Q16 mm to integer mm/s, for velocity in Q16 m/s
+static inline int32_t velocityMillimetresPerSecond(int32_t v)
+{
+  return (int32_t)(((int64_t)v * 1000 + 0x8000) >> 16);
+}
+
+// Height in mm above the surface; the estimate carries on across changes
+static inline void velocitySetHeight(VelocityEstimator * est, uint16_t heightMm)
+{
+  est->mmPerCount = (int32_t)(((uint64_t)heightMm * est->config.microradPerCount * 65536 + 500000) / 1000000);
+}
+
+static inline void velocityRestart(VelocityEstimator * est)
+{
+  est->vx = est->vy = 0;
+  est->ex = est->ey = 0;
+  est->p00 = velocityMul(est->config.countNoise, est->mmPerCount);
+  est->p00 = velocityMul(est->p00, est->p00);
+  est->p01 = 0;
+  est->p11 = velocityMul(est->config.initVelocity, est->config.initVelocity);
+  est->started = 0;
+}
+
+// config NULL for velocityDefaults
+static inline void velocityInit(VelocityEstimator * est, const VelocityConfig * config, uint16_t heightMm)
+{
+  est->config = config ? *config : velocityDefaults;
+  est->accelQ32 = (uint32_t)(((uint64_t)est->config.accelNoise << 16) / 1000); // m/s^2 is 1/1000 mm/ms^2
+  velocitySetHeight(est, heightMm);
+  est->updates = est->skipped = est->restarts = 0;
+  est->lastTimestamp = 0;
+  velocityRestart(est);
+}
+
+// One axis: predict, then correct with the measured displacement d (Q16 mm)
+static inline void velocityAxis(int32_t * e, int32_t * v, int32_t dt, int32_t d, int32_t k0, int32_t k1)
+{
+  int32_t innovation = d - (*e + velocityMul(*v, dt));
+  *e = velocityMul(k0, innovation) - innovation; // predicted + k0 * innovation - d
+  *v += velocityMul(k1, innovation);
+}
+
+// Returns 1 if the sample corrected the estimate
+static inline uint8_t velocityUpdate(VelocityEstimator * est, const PAW3902Sample * sample)
+{
+  uint32_t dtMicros = sample->timestamp - est->lastTimestamp;
+  est->lastTimestamp = sample->timestamp;
+  if(!est->started || dtMicros > est->config.maxGapMicros)
+  {
+    if(est->started) est->restarts++;
+    velocityRestart(est);
+    est->started = 1; // the first sample's counts span an unknown time
+    return 0;
+  }
+
+  // Predict: F = [1 dt; 0 1], Q from a random acceleration held over the step
+  int32_t dt = (int32_t)(((uint64_t)dtMicros * 67109) >> 10);            // Q16 ms
+  int32_t g = (int32_t)(((uint64_t)est->accelQ32 * (uint32_t)dt) >> 32); // Q16 m/s
+  int32_t q11 = velocityMul(g, g), q01 = velocityMul(q11, dt) >> 1, q00 = velocityMul(q01, dt) >> 1;
+  int32_t t = velocityMul(dt, est->p11);
+  int32_t p00 = velocityClamp((int64_t)est->p00 + 2 * (int64_t)velocityMul(dt, est->p01) + velocityMul(dt, t) + q00);
+  int32_t p01 = est->p01 + t + q01;
+  int32_t p11 = est->p11 + q11;
+
+  if(sample->confidence < est->config.minConfidence || sample->confidence == 0)
+  {
+    // Nothing to correct with; the track moves with the prediction, so e holds
+    est->p00 = p00;
+    est->p01 = p01;
+    est->p11 = p11;
+    est->skipped++;
+    return 0;
+  }
+
+  // R = (countNoise * 255 / confidence * mmPerCount)^2
+  int32_t noise = est->config.countNoise;
+  if(sample->confidence < 255) noise = (int32_t)((uint32_t)noise * 255 / sample->confidence);
+  int32_t r = velocityMul(noise, est->mmPerCount);
+  int32_t s = velocityClamp((int64_t)p00 + velocityMul(r, r));
+  if(s < 1) s = 1;
+
+  // K = [p00 p01] / s through one 32-bit divide: s normalized to 16 bits, 2^32 over that
+  uint8_t n = (uint8_t)__builtin_clz((uint32_t)s);
+  uint32_t top = n >= 16 ? (uint32_t)s << (n - 16) : (uint32_t)s >> (16 - n);
+  int64_t recip = 0xFFFFFFFFu / top;
+  int32_t k0 = (int32_t)(((int64_t)p00 * recip) >> (32 - n));
+  int32_t k1 = (int32_t)(((int64_t)p01 * recip) >> (32 - n));
+
+  // P = (I - K H) P
+  est->p00 = velocityMul(VELOCITY_ONE - k0, p00);
+  est->p01 = velocityMul(VELOCITY_ONE - k0, p01);
+  est->p11 = p11 - velocityMul(k1, p01);
+  if(est->p11 < 1) est->p11 = 1;
+  est->updates++;
+
+  int32_t dx = velocityClamp((int64_t)sample->deltaX * est->mmPerCount);
+  int32_t dy = velocityClamp((int64_t)sample->deltaY * est->mmPerCount);
+  velocityAxis(&est->ex, &est->vx, dt, dx, k0, k1);
+  velocityAxis(&est->ey, &est->vy, dt, dy, k0, k1);
+  return 1;
+}
+
+#endif //__VELOCITYESTIMATOR_H
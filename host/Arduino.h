@@ -0,0 +1,78 @@
+/* Host-side stand-in for the Arduino core, used to build and benchmark the
+ * PAW3902 library on Linux. Time is virtual: delay(), delayMicroseconds()
+ * and SPI traffic advance a nanosecond clock instead of sleeping, so runs are
+ * deterministic and report modeled on-target wall time.
+ */
+
+#ifndef __HOST_ARDUINO_H
+#define __HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0
+#define OUTPUT  1
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define DEC     10
+#define HEX     16
+
+#define MOSI    11 // Dragonfly default SPI MOSI pin
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int  digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts();
+void interrupts();
+
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+uint32_t millis();
+uint32_t micros();
+
+// Virtual clock
+uint64_t hostNanos();                // modeled time since start
+uint64_t hostDelayNanos();           // part of it spent in delay()/delayMicroseconds()
+void hostAdvance(uint64_t ns);       // charge work to the clock
+void hostWait(uint64_t ns);          // a delay finer than delayMicroseconds()
+
+// Interrupts. A bench's wait hook runs from every delay unless interrupts are
+// held off, with the time the delay ends, so it can run the handlers falling
+// due inside it at their time (hostAdvance() to each). noInterrupts() and
+// interrupts() nest here, and the hook runs with interrupts held off.
+void hostWaitHook(void (*hook)(uint64_t endNanos));
+
+class HardwareSerial {
+public:
+  void begin(uint32_t baud) { (void)baud; }
+  int available() { return 0; } // no input on the host
+  int read() { return -1; }
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  size_t print(const char *s);
+  size_t print(char c);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(double d, int digits = 2);
+  template <class T> size_t println(T value) { return print(value) + print('\n'); }
+  template <class T> size_t println(T value, int base) { return print(value, base) + print('\n'); }
+  size_t println() { return print('\n'); }
+};
+
+extern HardwareSerial Serial;
+
+#endif //__HOST_ARDUINO_H
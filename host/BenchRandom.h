@@ -0,0 +1,25 @@
+/* Seeded pseudo-random numbers for the host benches. Every bench binary
+ * starts from the same seed, so its synthetic traces, scenes and scripts
+ * come out the same on every run and every host.
+ */
+
+#ifndef __HOST_BENCHRANDOM_H
+#define __HOST_BENCHRANDOM_H
+
+#include <stdint.h>
+#include <math.h>
+
+static uint32_t benchLcg = 12345;
+
+static inline uint32_t benchRandom() // 32-bit LCG step, the low bits are weak
+{
+  benchLcg = benchLcg * 1664525 + 1013904223;
+  return benchLcg;
+}
+
+static inline double uniform() { return (benchRandom() >> 8) / 16777216.0; } // 0 .. 1
+static inline float uniformf() { return (benchRandom() >> 8) / 16777216.0f; } // 0 .. 1, for the float frame benches
+
+static inline double gaussian() { return sqrt(-2 * log(uniform() + 1e-12)) * cos(2 * M_PI * uniform()); } // zero mean, unit variance
+
+#endif //__HOST_BENCHRANDOM_H
@@ -0,0 +1,59 @@
+/* Host spidev node, see FakeSpidev.h. */
+
+#include <linux/spi/spidev.h>
+#include "FakeSpidev.h"
+
+FakeSpidev *fakeSpidev = NULL;
+
+FakeSpidev::FakeSpidev(HostSPIDevice *device, uint32_t clock)
+  : _device(device), _byteNanos(8000000000ULL / clock), _selected(false)
+{
+  resetCounters();
+}
+
+
+void FakeSpidev::select(bool selected)
+{
+  if(selected != _selected) _device->select(selected);
+  _selected = selected;
+}
+
+
+int FakeSpidev::ioctl(unsigned long request, void *arg)
+{
+  syscalls++;
+  hostAdvance(FAKE_SPIDEV_SYSCALL_NS);
+
+  if(_IOC_TYPE(request) != SPI_IOC_MAGIC) return -1;
+  if(_IOC_NR(request) != 0) return 0; // mode, bits, speed
+
+  uint32_t count = _IOC_SIZE(request) / sizeof(struct spi_ioc_transfer);
+  struct spi_ioc_transfer *xfer = (struct spi_ioc_transfer *)arg;
+  int total = 0;
+
+  for(uint32_t ii = 0; ii < count; ii++)
+  {
+    const struct spi_ioc_transfer &t = xfer[ii];
+    const uint8_t *tx = (const uint8_t *)(uintptr_t)t.tx_buf;
+    uint8_t *rx = (uint8_t *)(uintptr_t)t.rx_buf;
+
+    select(true);
+    for(uint32_t jj = 0; jj < t.len; jj++)
+    {
+      bytes++;
+      busNanos += _byteNanos;
+      hostAdvance(_byteNanos);
+      _device->byteNanos = _byteNanos;
+      uint8_t miso = _device->transfer(tx ? tx[jj] : 0);
+      if(rx) rx[jj] = miso;
+    }
+    if(t.delay_usecs) delayMicroseconds(t.delay_usecs);
+    segments++;
+    total += t.len;
+
+    bool last = ii + 1 == count;
+    if(t.cs_change != last) select(false); // cs_change inverts on the last segment
+  }
+
+  return total;
+}
@@ -0,0 +1,55 @@
+/* Stand-in for a Linux spidev node, for building and benchmarking the
+ * spidev transport (Linux/PAW3902Spidev.h) on the host.
+ *
+ * SPI_IOC_MESSAGE arrays are played into a HostSPIDevice on the virtual
+ * clock the way the kernel's SPI core runs them: nCS is asserted for the
+ * message, each segment clocks len bytes (zeros where tx_buf is null), then
+ * waits delay_usecs, and cs_change releases nCS before the next segment or,
+ * on the last one, keeps it asserted after the message. Every ioctl is
+ * counted and charged FAKE_SPIDEV_SYSCALL_NS. The mode, bits and speed
+ * ioctls succeed and change nothing.
+ */
+
+#ifndef __HOST_FAKESPIDEV_H
+#define __HOST_FAKESPIDEV_H
+
+#include "Arduino.h"
+#include "SPI.h"
+
+// Assumed cost of one ioctl round trip: syscall entry, message validation
+// and copies, and the wakeup when the controller finishes. Not measured.
+#define FAKE_SPIDEV_SYSCALL_NS 20000
+
+class FakeSpidev {
+public:
+  FakeSpidev(HostSPIDevice *device, uint32_t clock = 2000000);
+
+  int ioctl(unsigned long request, void *arg);
+
+  void resetCounters() { syscalls = 0; segments = 0; bytes = 0; busNanos = 0; }
+
+  uint32_t syscalls;  // ioctls of any kind
+  uint32_t segments;  // spi_ioc_transfer segments run
+  uint32_t bytes;     // bytes clocked
+  uint64_t busNanos;  // modeled time spent clocking them
+
+private:
+  HostSPIDevice *_device;
+  uint32_t _byteNanos;
+  bool _selected;
+
+  void select(bool selected);
+};
+
+extern FakeSpidev *fakeSpidev; // node FakeSpidevSys talks to
+
+// System calls for PAW3902SpidevBus<FakeSpidevSys>: the fake node and the
+// virtual clock
+struct FakeSpidevSys {
+  static int ioctl(int fd, unsigned long request, void *arg) { (void)fd; return fakeSpidev->ioctl(request, arg); }
+  static void sleepMicros(uint32_t us) { delayMicroseconds(us); }
+  static uint32_t micros() { return ::micros(); }
+  static uint32_t ticks() { return (uint32_t)hostNanos(); } // ns, as steady_clock on the target
+};
+
+#endif //__HOST_FAKESPIDEV_H
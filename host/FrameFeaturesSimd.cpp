@@ -0,0 +1,179 @@
+/* Vector corner scoring for FrameFeaturesSimd.h.
+ *
+ * A row of centres, columns 3 .. 31, is scored as two overlapping runs of
+ * 16 (3 .. 18 and 16 .. 31) so every load stays inside the 35 x 35 frame.
+ * Per lane, saturating subtraction gives how far each ring pixel is past
+ * c + threshold (above) or c - threshold (below), which is both the test and
+ * the score term; arcs are found by counting consecutive set lanes once
+ * round the ring and on past the start for the ones that wrap.
+ */
+
+#include <string.h>
+#include "FrameFeaturesSimd.h"
+
+#if !defined(FRAMEFEATURES_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#define FRAMEFEATURES_NAME "SSE2"
+#elif !defined(FRAMEFEATURES_SCALAR) && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define FRAMEFEATURES_NAME "NEON"
+#else
+#define FRAMEFEATURES_NAME "scalar"
+#endif
+
+// Both runs are of centres only, so they load nothing featureScore() would not
+static_assert(FEATURE_LAST - FEATURE_FIRST + 1 >= 16 && FEATURE_LAST - FEATURE_FIRST + 1 <= 32, "two runs of 16 cover a row");
+
+#if !defined(FRAMEFEATURES_SCALAR) && defined(__SSE2__)
+// Scores of the 16 centres from p into out
+static void scoreRun(const uint8_t *p, uint8_t threshold, uint16_t *out)
+{
+  const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi8(1), arc = _mm_set1_epi8(FEATURE_ARC - 1);
+  const __m128i c = _mm_loadu_si128((const __m128i *)p), t = _mm_set1_epi8((char)threshold);
+  const __m128i hi = _mm_adds_epu8(c, t), lo = _mm_subs_epu8(c, t);
+
+  // Compass points first, as featureScore() does
+  __m128i above[16], below[16], isAbove[4], isBelow[4];
+  for(int ii = 0; ii < 4; ii++)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + featureRing[4 * ii]));
+    isAbove[ii] = _mm_cmpeq_epi8(_mm_subs_epu8(v, hi), zero); // 0xFF where not above
+    isBelow[ii] = _mm_cmpeq_epi8(_mm_subs_epu8(lo, v), zero);
+  }
+  __m128i pass = zero;
+  for(int ii = 0; ii < 4; ii++)
+  {
+    pass = _mm_or_si128(pass, _mm_andnot_si128(_mm_or_si128(isAbove[ii], isAbove[(ii + 1) & 3]), _mm_set1_epi8(-1)));
+    pass = _mm_or_si128(pass, _mm_andnot_si128(_mm_or_si128(isBelow[ii], isBelow[(ii + 1) & 3]), _mm_set1_epi8(-1)));
+  }
+  if(!_mm_movemask_epi8(pass))
+  {
+    memset(out, 0, 16 * sizeof(uint16_t));
+    return;
+  }
+
+  for(int ii = 0; ii < 16; ii++)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + featureRing[ii]));
+    above[ii] = _mm_subs_epu8(v, hi);
+    below[ii] = _mm_subs_epu8(lo, v);
+  }
+
+  // Longest run of set lanes, going on past the start far enough for an arc that wraps
+  __m128i runAbove = zero, runBelow = zero, bestAbove = zero, bestBelow = zero;
+  for(int ii = 0; ii < 16 + FEATURE_ARC - 1; ii++)
+  {
+    runAbove = _mm_andnot_si128(_mm_cmpeq_epi8(above[ii & 15], zero), _mm_add_epi8(runAbove, one));
+    runBelow = _mm_andnot_si128(_mm_cmpeq_epi8(below[ii & 15], zero), _mm_add_epi8(runBelow, one));
+    bestAbove = _mm_max_epu8(bestAbove, runAbove);
+    bestBelow = _mm_max_epu8(bestBelow, runBelow);
+  }
+  __m128i cornerAbove = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_max_epu8(bestAbove, arc), arc), pass);
+  __m128i cornerBelow = _mm_andnot_si128(_mm_or_si128(cornerAbove, _mm_cmpeq_epi8(_mm_max_epu8(bestBelow, arc), arc)), pass);
+
+  __m128i sumAboveLo = zero, sumAboveHi = zero, sumBelowLo = zero, sumBelowHi = zero;
+  for(int ii = 0; ii < 16; ii++)
+  {
+    sumAboveLo = _mm_add_epi16(sumAboveLo, _mm_unpacklo_epi8(above[ii], zero));
+    sumAboveHi = _mm_add_epi16(sumAboveHi, _mm_unpackhi_epi8(above[ii], zero));
+    sumBelowLo = _mm_add_epi16(sumBelowLo, _mm_unpacklo_epi8(below[ii], zero));
+    sumBelowHi = _mm_add_epi16(sumBelowHi, _mm_unpackhi_epi8(below[ii], zero));
+  }
+  __m128i scoreLo = _mm_or_si128(_mm_and_si128(_mm_unpacklo_epi8(cornerAbove, cornerAbove), sumAboveLo),
+                                 _mm_and_si128(_mm_unpacklo_epi8(cornerBelow, cornerBelow), sumBelowLo));
+  __m128i scoreHi = _mm_or_si128(_mm_and_si128(_mm_unpackhi_epi8(cornerAbove, cornerAbove), sumAboveHi),
+                                 _mm_and_si128(_mm_unpackhi_epi8(cornerBelow, cornerBelow), sumBelowHi));
+  _mm_storeu_si128((__m128i *)out, scoreLo);
+  _mm_storeu_si128((__m128i *)(out + 8), scoreHi);
+}
+#elif !defined(FRAMEFEATURES_SCALAR) && defined(__ARM_NEON) && defined(__aarch64__)
+static void scoreRun(const uint8_t *p, uint8_t threshold, uint16_t *out)
+{
+  const uint8x16_t c = vld1q_u8(p), t = vdupq_n_u8(threshold), arc = vdupq_n_u8(FEATURE_ARC - 1);
+  const uint8x16_t hi = vqaddq_u8(c, t), lo = vqsubq_u8(c, t);
+
+  uint8x16_t isAbove[4], isBelow[4], pass = vdupq_n_u8(0);
+  for(int ii = 0; ii < 4; ii++)
+  {
+    uint8x16_t v = vld1q_u8(p + featureRing[4 * ii]);
+    isAbove[ii] = vcgtq_u8(v, hi);
+    isBelow[ii] = vcltq_u8(v, lo);
+  }
+  for(int ii = 0; ii < 4; ii++)
+    pass = vorrq_u8(pass, vorrq_u8(vandq_u8(isAbove[ii], isAbove[(ii + 1) & 3]), vandq_u8(isBelow[ii], isBelow[(ii + 1) & 3])));
+  if(vmaxvq_u8(pass) == 0)
+  {
+    memset(out, 0, 16 * sizeof(uint16_t));
+    return;
+  }
+
+  uint8x16_t above[16], below[16];
+  for(int ii = 0; ii < 16; ii++)
+  {
+    uint8x16_t v = vld1q_u8(p + featureRing[ii]);
+    above[ii] = vqsubq_u8(v, hi);
+    below[ii] = vqsubq_u8(lo, v);
+  }
+
+  uint8x16_t runAbove = vdupq_n_u8(0), runBelow = runAbove, bestAbove = runAbove, bestBelow = runAbove;
+  for(int ii = 0; ii < 16 + FEATURE_ARC - 1; ii++)
+  {
+    runAbove = vandq_u8(vtstq_u8(above[ii & 15], above[ii & 15]), vaddq_u8(runAbove, vdupq_n_u8(1)));
+    runBelow = vandq_u8(vtstq_u8(below[ii & 15], below[ii & 15]), vaddq_u8(runBelow, vdupq_n_u8(1)));
+    bestAbove = vmaxq_u8(bestAbove, runAbove);
+    bestBelow = vmaxq_u8(bestBelow, runBelow);
+  }
+  uint8x16_t cornerAbove = vandq_u8(vcgtq_u8(bestAbove, arc), pass);
+  uint8x16_t cornerBelow = vbicq_u8(vandq_u8(vcgtq_u8(bestBelow, arc), pass), cornerAbove);
+
+  uint16x8_t sumAboveLo = vdupq_n_u16(0), sumAboveHi = sumAboveLo, sumBelowLo = sumAboveLo, sumBelowHi = sumAboveLo;
+  for(int ii = 0; ii < 16; ii++)
+  {
+    sumAboveLo = vaddw_u8(sumAboveLo, vget_low_u8(above[ii]));
+    sumAboveHi = vaddw_u8(sumAboveHi, vget_high_u8(above[ii]));
+    sumBelowLo = vaddw_u8(sumBelowLo, vget_low_u8(below[ii]));
+    sumBelowHi = vaddw_u8(sumBelowHi, vget_high_u8(below[ii]));
+  }
+  uint16x8_t maskAboveLo = vmovl_u8(vget_low_u8(cornerAbove)), maskAboveHi = vmovl_u8(vget_high_u8(cornerAbove));
+  uint16x8_t maskBelowLo = vmovl_u8(vget_low_u8(cornerBelow)), maskBelowHi = vmovl_u8(vget_high_u8(cornerBelow));
+  // vmovl gives 0x00FF per set lane; widen the mask to all ones
+  maskAboveLo = vtstq_u16(maskAboveLo, maskAboveLo); maskAboveHi = vtstq_u16(maskAboveHi, maskAboveHi);
+  maskBelowLo = vtstq_u16(maskBelowLo, maskBelowLo); maskBelowHi = vtstq_u16(maskBelowHi, maskBelowHi);
+  vst1q_u16(out, vorrq_u16(vandq_u16(maskAboveLo, sumAboveLo), vandq_u16(maskBelowLo, sumBelowLo)));
+  vst1q_u16(out + 8, vorrq_u16(vandq_u16(maskAboveHi, sumAboveHi), vandq_u16(maskBelowHi, sumBelowHi)));
+}
+#else
+static void scoreRun(const uint8_t *p, uint8_t threshold, uint16_t *out)
+{
+  for(int ii = 0; ii < 16; ii++) out[ii] = featureScore(p + ii, threshold);
+}
+#endif
+
+uint16_t frameFeaturesSimd(const uint8_t * frame, uint8_t threshold, FrameFeature * features, uint16_t max)
+{
+  uint16_t score[FRAME_HEIGHT][FRAME_WIDTH]; // zero outside the centres, as featureScoreAt()
+  memset(score, 0, sizeof(score));
+  for(int y = FEATURE_FIRST; y <= FEATURE_LAST; y++)
+  {
+    scoreRun(&frame[y * FRAME_WIDTH + FEATURE_FIRST], threshold, &score[y][FEATURE_FIRST]);
+    scoreRun(&frame[y * FRAME_WIDTH + FEATURE_LAST - 15], threshold, &score[y][FEATURE_LAST - 15]);
+  }
+
+  // Peaks as featurePeak() picks them: beat the neighbours before, at least match those after
+  uint16_t count = 0;
+  for(int y = FEATURE_FIRST; y <= FEATURE_LAST && count < max; y++)
+    for(int x = FEATURE_FIRST; x <= FEATURE_LAST && count < max; x++)
+    {
+      uint16_t s = score[y][x];
+      if(!s) continue;
+      if(s <= score[y - 1][x - 1] || s <= score[y - 1][x] || s <= score[y - 1][x + 1] || s <= score[y][x - 1] ||
+         s < score[y][x + 1] || s < score[y + 1][x - 1] || s < score[y + 1][x] || s < score[y + 1][x + 1]) continue;
+      features[count].x = (uint8_t)x;
+      features[count].y = (uint8_t)y;
+      features[count].score = s;
+      count++;
+    }
+  return count;
+}
+
+const char *frameFeaturesKernel() { return FRAMEFEATURES_NAME; }
@@ -0,0 +1,18 @@
+/* FrameFeatures.h with the corner scoring vectorized, for the host.
+ *
+ * Scores 16 centres of a row at once with SSE2 or NEON (AArch64), whichever
+ * the compiler targets, into a score map on the stack, then keeps the peaks as
+ * frameFeatures() does. The result is the same list, bit for bit; the scalar
+ * path is used without either, or with -DFRAMEFEATURES_SCALAR.
+ */
+
+#ifndef __HOST_FRAMEFEATURESSIMD_H
+#define __HOST_FRAMEFEATURESSIMD_H
+
+#include "FrameFeatures.h"
+
+uint16_t frameFeaturesSimd(const uint8_t * frame, uint8_t threshold, FrameFeature * features, uint16_t max);
+
+const char *frameFeaturesKernel(); // "SSE2", "NEON" or "scalar"
+
+#endif //__HOST_FRAMEFEATURESSIMD_H
@@ -0,0 +1,175 @@
+/* SAD block matching for FrameFlow.h.
+ *
+ * Frames are copied into rows padded to FRAMEFLOW_STRIDE bytes so a kernel
+ * can load a full vector at any candidate position without running off the
+ * frame; lanes past the compared width are masked out of the sum.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "FrameFlow.h"
+
+#if !defined(FRAMEFLOW_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+#define FRAMEFLOW_KERNEL sadAVX2
+#define FRAMEFLOW_NAME   "AVX2"
+#elif !defined(FRAMEFLOW_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#define FRAMEFLOW_KERNEL sadSSE2
+#define FRAMEFLOW_NAME   "SSE2"
+#elif !defined(FRAMEFLOW_SCALAR) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FRAMEFLOW_KERNEL sadNEON
+#define FRAMEFLOW_NAME   "NEON"
+#else
+#define FRAMEFLOW_KERNEL sadScalar
+#define FRAMEFLOW_NAME   "scalar"
+#endif
+
+#define FRAMEFLOW_STRIDE 64 // widest load starts at most 2 * FRAMEFLOW_RADIUS in and reads 32 bytes
+#define FRAMEFLOW_SHIFTS (2 * FRAMEFLOW_RADIUS + 1)
+
+static_assert(FRAMEFLOW_AREA <= 32, "kernels compare at most 32 pixels per row");
+static_assert(FRAMEFLOW_GRID * FRAMEFLOW_BLOCK == FRAMEFLOW_AREA, "dense blocks tile the central area");
+static_assert(2 * FRAMEFLOW_RADIUS + 32 <= FRAMEFLOW_STRIDE, "loads stay inside the padded row");
+
+struct PaddedFrame {
+  alignas(32) uint8_t px[FRAME_HEIGHT * FRAMEFLOW_STRIDE];
+
+  explicit PaddedFrame(const uint8_t *frame)
+  {
+    for(int y = 0; y < FRAME_HEIGHT; y++)
+    {
+      memcpy(&px[y * FRAMEFLOW_STRIDE], &frame[y * FRAME_WIDTH], FRAME_WIDTH);
+      memset(&px[y * FRAMEFLOW_STRIDE + FRAME_WIDTH], 0, FRAMEFLOW_STRIDE - FRAME_WIDTH);
+    }
+  }
+};
+
+// 32 lanes set, then 32 clear: loading at 32 - n sets the first n lanes
+alignas(32) static const uint8_t laneMask[64] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+static inline const uint8_t *firstLanes(int n) { return &laneMask[32 - (n < 0 ? 0 : n > 32 ? 32 : n)]; }
+
+// SAD of a width x height region (width up to 32) at a against the one at b
+typedef uint32_t (*SadKernel)(const uint8_t *a, const uint8_t *b, int width, int height);
+
+static uint32_t sadScalar(const uint8_t *a, const uint8_t *b, int width, int height)
+{
+  uint32_t sum = 0;
+  for(int y = 0; y < height; y++, a += FRAMEFLOW_STRIDE, b += FRAMEFLOW_STRIDE)
+    for(int x = 0; x < width; x++) sum += abs(a[x] - b[x]);
+  return sum;
+}
+
+#if !defined(FRAMEFLOW_SCALAR) && defined(__AVX2__)
+static uint32_t sadAVX2(const uint8_t *a, const uint8_t *b, int width, int height)
+{
+  const __m256i mask = _mm256_loadu_si256((const __m256i *)firstLanes(width));
+  __m256i sum = _mm256_setzero_si256();
+  for(int y = 0; y < height; y++, a += FRAMEFLOW_STRIDE, b += FRAMEFLOW_STRIDE)
+  {
+    __m256i va = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)a), mask);
+    __m256i vb = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)b), mask);
+    sum = _mm256_add_epi64(sum, _mm256_sad_epu8(va, vb));
+  }
+  __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  return (uint32_t)(_mm_cvtsi128_si32(half) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(half, half)));
+}
+#elif !defined(FRAMEFLOW_SCALAR) && defined(__SSE2__)
+static uint32_t sadSSE2(const uint8_t *a, const uint8_t *b, int width, int height)
+{
+  const __m128i lo = _mm_loadu_si128((const __m128i *)firstLanes(width));
+  const __m128i hi = _mm_loadu_si128((const __m128i *)firstLanes(width - 16));
+  __m128i sum = _mm_setzero_si128();
+  for(int y = 0; y < height; y++, a += FRAMEFLOW_STRIDE, b += FRAMEFLOW_STRIDE)
+  {
+    __m128i va = _mm_and_si128(_mm_loadu_si128((const __m128i *)a), lo);
+    __m128i vb = _mm_and_si128(_mm_loadu_si128((const __m128i *)b), lo);
+    sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+    if(width > 16)
+    {
+      va = _mm_and_si128(_mm_loadu_si128((const __m128i *)(a + 16)), hi);
+      vb = _mm_and_si128(_mm_loadu_si128((const __m128i *)(b + 16)), hi);
+      sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+    }
+  }
+  return (uint32_t)(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sum, sum)));
+}
+#elif !defined(FRAMEFLOW_SCALAR) && defined(__ARM_NEON)
+// Pairwise accumulation into 16-bit lanes holds 32 rows of two 16-byte halves
+static uint32_t sadNEON(const uint8_t *a, const uint8_t *b, int width, int height)
+{
+  const uint8x16_t lo = vld1q_u8(firstLanes(width));
+  const uint8x16_t hi = vld1q_u8(firstLanes(width - 16));
+  uint16x8_t sum = vdupq_n_u16(0);
+  for(int y = 0; y < height; y++, a += FRAMEFLOW_STRIDE, b += FRAMEFLOW_STRIDE)
+  {
+    sum = vpadalq_u8(sum, vandq_u8(vabdq_u8(vld1q_u8(a), vld1q_u8(b)), lo));
+    if(width > 16) sum = vpadalq_u8(sum, vandq_u8(vabdq_u8(vld1q_u8(a + 16), vld1q_u8(b + 16)), hi));
+  }
+  uint64x2_t total = vpaddlq_u32(vpaddlq_u16(sum));
+  return (uint32_t)(vgetq_lane_u64(total, 0) + vgetq_lane_u64(total, 1));
+}
+#endif
+
+// Vertex of the parabola through costs at -1, 0 and +1, within half a pixel
+static float parabola(uint32_t left, uint32_t centre, uint32_t right)
+{
+  int32_t curvature = (int32_t)left - 2 * (int32_t)centre + (int32_t)right;
+  if(curvature <= 0) return 0;
+  float offset = 0.5f * ((int32_t)left - (int32_t)right) / curvature;
+  return offset > 0.5f ? 0.5f : offset < -0.5f ? -0.5f : offset;
+}
+
+// Best shift of the size x size region of a at (x, y) within b
+template <SadKernel sad>
+static void match(const PaddedFrame &a, const PaddedFrame &b, int x, int y, int size, FrameFlowVector *flow)
+{
+  uint32_t cost[FRAMEFLOW_SHIFTS][FRAMEFLOW_SHIFTS];
+  const uint8_t *pa = &a.px[y * FRAMEFLOW_STRIDE + x];
+  int bestX = 0, bestY = 0;
+  for(int dy = 0; dy < FRAMEFLOW_SHIFTS; dy++)
+    for(int dx = 0; dx < FRAMEFLOW_SHIFTS; dx++)
+    {
+      const uint8_t *pb = &b.px[(y + dy - FRAMEFLOW_RADIUS) * FRAMEFLOW_STRIDE + x + dx - FRAMEFLOW_RADIUS];
+      cost[dy][dx] = sad(pa, pb, size, size);
+      if(cost[dy][dx] < cost[bestY][bestX]) { bestX = dx; bestY = dy; }
+    }
+
+  flow->dx = (float)(bestX - FRAMEFLOW_RADIUS);
+  flow->dy = (float)(bestY - FRAMEFLOW_RADIUS);
+  flow->sad = cost[bestY][bestX];
+  flow->pixels = (uint16_t)(size * size);
+  flow->refined = bestX > 0 && bestX < FRAMEFLOW_SHIFTS - 1 && bestY > 0 && bestY < FRAMEFLOW_SHIFTS - 1;
+  if(!flow->refined) return;
+  flow->dx += parabola(cost[bestY][bestX - 1], cost[bestY][bestX], cost[bestY][bestX + 1]);
+  flow->dy += parabola(cost[bestY - 1][bestX], cost[bestY][bestX], cost[bestY + 1][bestX]);
+}
+
+template <SadKernel sad>
+static void global(const uint8_t *a, const uint8_t *b, FrameFlowVector *flow)
+{
+  PaddedFrame pa(a), pb(b);
+  match<sad>(pa, pb, FRAMEFLOW_RADIUS, FRAMEFLOW_RADIUS, FRAMEFLOW_AREA, flow);
+}
+
+template <SadKernel sad>
+static void dense(const uint8_t *a, const uint8_t *b, FrameFlowVector *flow)
+{
+  PaddedFrame pa(a), pb(b);
+  for(int by = 0; by < FRAMEFLOW_GRID; by++)
+    for(int bx = 0; bx < FRAMEFLOW_GRID; bx++)
+      match<sad>(pa, pb, FRAMEFLOW_RADIUS + bx * FRAMEFLOW_BLOCK, FRAMEFLOW_RADIUS + by * FRAMEFLOW_BLOCK,
+                 FRAMEFLOW_BLOCK, &flow[by * FRAMEFLOW_GRID + bx]);
+}
+
+void frameFlowGlobal(const uint8_t *a, const uint8_t *b, FrameFlowVector *flow) { global<FRAMEFLOW_KERNEL>(a, b, flow); }
+void frameFlowDense(const uint8_t *a, const uint8_t *b, FrameFlowVector *flow) { dense<FRAMEFLOW_KERNEL>(a, b, flow); }
+void frameFlowGlobalScalar(const uint8_t *a, const uint8_t *b, FrameFlowVector *flow) { global<sadScalar>(a, b, flow); }
+void frameFlowDenseScalar(const uint8_t *a, const uint8_t *b, FrameFlowVector *flow) { dense<sadScalar>(a, b, flow); }
+
+const char *frameFlowKernel() { return FRAMEFLOW_NAME; }
@@ -0,0 +1,48 @@
+/* Block-matching optical flow between two 35 x 35 frames from captureFrame(),
+ * for checking the sensor's own motion counts against the image content.
+ *
+ * Both searches minimize the sum of absolute differences (SAD) over whole
+ * pixel shifts of up to FRAMEFLOW_RADIUS each way, then refine the minimum
+ * to sub-pixel by fitting a parabola through it and its two neighbours along
+ * each axis.
+ *
+ *  - global: one vector for the frame, matching the central 27 x 27 pixels of
+ *    a against b at every shift, so every candidate covers the same area
+ *  - dense:  one vector per 9 x 9 block of that central area, 3 x 3 blocks
+ *
+ * The SAD kernel uses AVX2, SSE2 or NEON, whichever the compiler targets
+ * (-mavx2 for AVX2), and plain C++ otherwise or with -DFRAMEFLOW_SCALAR. The
+ * ...Scalar() versions are always built, for cross-checks and timing; both
+ * give the same results bit for bit.
+ *
+ * Vectors point where the content of a moved to in b, in pixels: +dx to the
+ * right (rising column), +dy down (rising row).
+ */
+
+#ifndef __HOST_FRAMEFLOW_H
+#define __HOST_FRAMEFLOW_H
+
+#include <stdint.h>
+#include "FrameExport.h"
+
+#define FRAMEFLOW_RADIUS 4  // search range, pixels each way
+#define FRAMEFLOW_BLOCK  9  // dense block size
+#define FRAMEFLOW_GRID   3  // dense blocks per side
+#define FRAMEFLOW_AREA   (FRAME_WIDTH - 2 * FRAMEFLOW_RADIUS) // side of the matched central area
+
+struct FrameFlowVector {
+  float    dx, dy;  // pixels
+  uint32_t sad;     // at the best whole-pixel shift
+  uint16_t pixels;  // pixels compared, for sad per pixel
+  bool     refined; // false if the best shift is on the edge of the search, so dx/dy are whole pixels at best
+};
+
+void frameFlowGlobal(const uint8_t *a, const uint8_t *b, FrameFlowVector *flow);
+void frameFlowDense(const uint8_t *a, const uint8_t *b, FrameFlowVector flow[FRAMEFLOW_GRID * FRAMEFLOW_GRID]);
+
+void frameFlowGlobalScalar(const uint8_t *a, const uint8_t *b, FrameFlowVector *flow);
+void frameFlowDenseScalar(const uint8_t *a, const uint8_t *b, FrameFlowVector flow[FRAMEFLOW_GRID * FRAMEFLOW_GRID]);
+
+const char *frameFlowKernel(); // "AVX2", "SSE2", "NEON" or "scalar"
+
+#endif //__HOST_FRAMEFLOW_H
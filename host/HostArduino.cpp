@@ -0,0 +1,119 @@
+/* Virtual-time implementation of the host Arduino/SPI stand-ins.
+ *
+ * Modeled costs are rough figures for the STM32L4 Arduino core at 80 MHz:
+ * SPI.beginTransaction() reprograms the peripheral, digitalWrite() is a
+ * register write behind a pin lookup. SPI bytes are charged at 8 bits per
+ * SPISettings clock.
+ */
+
+#include "Arduino.h"
+#include "SPI.h"
+
+#define BEGIN_TRANSACTION_NS 2000
+#define END_TRANSACTION_NS    500
+#define DIGITAL_WRITE_NS      100
+
+static uint64_t clockNanos = 0, delayNanos = 0;
+static void (*waitHook)(uint64_t endNanos) = NULL;
+static uint32_t interruptsOff = 0; // noInterrupts() depth
+
+HardwareSerial Serial;
+SPIClass SPI;
+
+uint64_t hostNanos()      { return clockNanos; }
+uint64_t hostDelayNanos() { return delayNanos; }
+void hostAdvance(uint64_t ns) { clockNanos += ns; }
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  hostAdvance(DIGITAL_WRITE_NS);
+  SPI.chipSelect(pin, value);
+}
+
+int  digitalRead(uint8_t pin) { (void)pin; return HIGH; }
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) { (void)pin; (void)handler; (void)mode; }
+void detachInterrupt(uint8_t pin) { (void)pin; }
+void noInterrupts() { interruptsOff++; }
+void interrupts() { if(interruptsOff) interruptsOff--; }
+void hostWaitHook(void (*hook)(uint64_t endNanos)) { waitHook = hook; }
+
+void delay(uint32_t ms) { hostWait(1000000ULL * ms); }
+
+void delayMicroseconds(uint32_t us) { hostWait(1000ULL * us); }
+
+void hostWait(uint64_t ns)
+{
+  uint64_t end = clockNanos + ns;
+  delayNanos += ns;
+  if(waitHook && !interruptsOff)
+  {
+    noInterrupts();
+    waitHook(end);
+    interrupts();
+  }
+  if(clockNanos < end) clockNanos = end; // handlers that ran past the end stretch the delay
+}
+
+uint32_t millis() { return (uint32_t)(clockNanos / 1000000ULL); }
+uint32_t micros() { return (uint32_t)(clockNanos / 1000ULL); }
+
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+  _nanosPerByte = 8000000000ULL / settings.clock;
+  transactions++;
+  hostAdvance(BEGIN_TRANSACTION_NS);
+}
+
+void SPIClass::endTransaction()
+{
+  hostAdvance(END_TRANSACTION_NS);
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+  bytes++;
+  busNanos += _nanosPerByte;
+  hostAdvance(_nanosPerByte);
+  if(!_device) return 0;
+  _device->byteNanos = _nanosPerByte;
+  return _device->transfer(data);
+}
+
+void SPIClass::transfer(void *buffer, size_t count)
+{
+  uint8_t *buf = (uint8_t *)buffer;
+  for(size_t ii = 0; ii < count; ii++) buf[ii] = transfer(buf[ii]);
+}
+
+void SPIClass::attach(HostSPIDevice *device, uint8_t cspin)
+{
+  uint8_t ii = 0;
+  while(ii < _attached && _pins[ii] != cspin) ii++;
+  if(ii == HOST_SPI_DEVICES) return;
+  if(ii == _attached) _attached++;
+  _devices[ii] = device;
+  _pins[ii] = cspin;
+}
+
+void SPIClass::chipSelect(uint8_t pin, uint8_t value)
+{
+  for(uint8_t ii = 0; ii < _attached; ii++)
+  {
+    if(_pins[ii] != pin) continue;
+    _devices[ii]->select(value == LOW);
+    if(value == LOW) _device = _devices[ii];
+    else if(_device == _devices[ii]) _device = NULL;
+  }
+}
+
+
+size_t HardwareSerial::write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+size_t HardwareSerial::print(const char *s) { return fputs(s, stdout) < 0 ? 0 : strlen(s); }
+size_t HardwareSerial::print(char c) { return write((uint8_t)c); }
+size_t HardwareSerial::print(long n, int base) { return printf(base == HEX ? "%lX" : "%ld", n); }
+size_t HardwareSerial::print(unsigned long n, int base) { return printf(base == HEX ? "%lX" : "%lu", n); }
+size_t HardwareSerial::print(double d, int digits) { return printf("%.*f", digits, d); }
@@ -0,0 +1,150 @@
+/* PAW3902Core transport that drives a HostSPIDevice directly, bypassing the
+ * Arduino SPI stand-in. Only clocked bytes and the datasheet gaps cost
+ * virtual time; there is no digitalWrite() or transaction overhead, so runs
+ * on this bus show the floor the sensor's own timing sets. Chip select is
+ * held across frame reads, as on the Arduino bus. The tSWW/tSRR gap after a
+ * command is only waited out when the next one starts, to the nanosecond.
+ * Bus claims hold interrupts off, as SPI.usingInterrupt() does for the
+ * Arduino bus's transactions, and settle() lets them in for its wait.
+ *
+ *     PAW3902Sim sensor;
+ *     PAW3902Core<PAW3902HostBus> flow((PAW3902HostBus(&sensor)));
+ */
+
+#ifndef __HOST_PAW3902HOSTBUS_H
+#define __HOST_PAW3902HOSTBUS_H
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "PAW3902Core.h"
+
+class PAW3902HostBus {
+public:
+  PAW3902HostBus(HostSPIDevice *device, uint32_t clock = 2000000)
+    : transactions(0), bytes(0), busNanos(0), _device(device), _byteNanos(8000000000ULL / clock),
+      _gapEnd(0), _gap(0) { }
+
+  void begin()
+  {
+    _device->select(false);
+    delay(1);
+    _device->select(true);
+    delay(1);
+    _device->select(false);
+    delay(1);
+  }
+
+  void beginTransaction() { transactions++; noInterrupts(); }
+  void endTransaction() { interrupts(); }
+
+  void write(uint8_t reg, uint8_t value)
+  {
+    waitGap();
+    _device->select(true);
+    transfer(reg | 0x80);
+    transfer(value);
+    delayMicroseconds(1);
+    _device->select(false);
+    endCommand(PAW3902_tSWW);
+  }
+
+  uint8_t read(uint8_t reg)
+  {
+    waitGap();
+    _device->select(true);
+    delayMicroseconds(1);
+    transfer(reg & 0x7F);
+    delayMicroseconds(PAW3902_tSRAD);
+    uint8_t temp = transfer(0);
+    delayMicroseconds(1);
+    _device->select(false);
+    endCommand(PAW3902_tSRR);
+    return temp;
+  }
+
+  void readBurst(uint8_t * dataArray)
+  {
+    transactions++;
+    noInterrupts();
+    waitGap();
+    _device->select(true);
+    delayMicroseconds(1);
+    transfer(0x16);
+    delayMicroseconds(PAW3902_tSRAD);
+    for(uint8_t ii = 0; ii < 12; ii++) dataArray[ii] = transfer(0xFF); // MOSI held high
+    _device->select(false);
+    delayMicroseconds(1);
+    endCommand(PAW3902_tSRR);
+    interrupts();
+  }
+
+  void beginStream()
+  {
+    transactions++;
+    noInterrupts();
+    _device->select(true);
+    delayMicroseconds(1);
+  }
+
+  uint8_t streamRead(uint8_t reg)
+  {
+    waitGap();
+    transfer(reg);
+    delayMicroseconds(PAW3902_tSRAD);
+    uint8_t temp = transfer(0);
+    endCommand(PAW3902_tSRR);
+    return temp;
+  }
+
+  void endStream() { _device->select(false); interrupts(); }
+
+  bool settle(uint8_t ms)
+  {
+    interrupts();
+    delay(ms);
+    noInterrupts();
+    transactions++;
+    return true;
+  }
+
+  void delayMicros(uint32_t us) { delayMicroseconds(us); }
+  void delayMillis(uint32_t ms) { delay(ms); }
+  uint32_t micros() { return ::micros(); }
+  uint32_t ticks() { return (uint32_t)hostNanos(); }
+  uint32_t ticksPerMicro() { return 1000; }
+
+  void resetCounters() { transactions = 0; bytes = 0; busNanos = 0; }
+
+  uint32_t transactions; // bus claims, as counted by SPIClass
+  uint32_t bytes;        // bytes clocked
+  uint64_t busNanos;     // modeled time spent clocking them
+
+private:
+  HostSPIDevice *_device;
+  uint32_t _byteNanos;
+  uint64_t _gapEnd; // hostNanos() before which the next command may not start
+  uint8_t _gap;
+
+  void endCommand(uint8_t gap) { _gapEnd = hostNanos() + gap * 1000ULL; _gap = gap; }
+
+  void waitGap()
+  {
+#if PAW3902_DEADLINE_GAPS
+    uint64_t now = hostNanos();
+    if(now < _gapEnd) hostWait(_gapEnd - now);
+#else
+    delayMicroseconds(_gap);
+#endif
+  }
+
+  uint8_t transfer(uint8_t mosi)
+  {
+    bytes++;
+    busNanos += _byteNanos;
+    hostAdvance(_byteNanos);
+    _device->byteNanos = _byteNanos;
+    return _device->transfer(mosi);
+  }
+};
+
+#endif //__HOST_PAW3902HOSTBUS_H
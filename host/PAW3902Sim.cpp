@@ -0,0 +1,194 @@
+/* Register-level PAW3902 model, see PAW3902Sim.h. */
+
+#include "PAW3902Sim.h"
+#include "PAW3902Tables.h"
+
+PAW3902Sim::PAW3902Sim()
+  : _selected(false), _phase(ADDRESS), _address(0), _burstIndex(0),
+    _addressNanos(0), _lastReadNanos(0), _lastWriteNanos(0), _selectNanos(0),
+    _accX(0), _accY(0), _SQUAL(100), _rawDataSum(0x40), _shutter(0x0400),
+    _upper(true), _pixel(0), _notReadyOneIn(0), _lcg(1)
+{
+  for(uint16_t ii = 0; ii < 35*35; ii++) _frame[ii] = (uint8_t)(ii * 7);
+  powerOnReset();
+  resetStats();
+}
+
+
+void PAW3902Sim::powerOnReset()
+{
+  memset(_regs, 0, sizeof(_regs));
+  _regs[0][0x00] = 0x49; // product ID
+  _regs[0][0x5F] = 0xB6; // inverse product ID
+  _bank = 0;
+  _shutdown = false;
+  _grabbing = false;
+  _accX = _accY = 0;
+  stats.resets++;
+}
+
+
+void PAW3902Sim::select(bool selected)
+{
+  uint64_t now = hostNanos();
+  if(selected && !_selected)
+  {
+    stats.selects++;
+    _selectNanos = now;
+  }
+  else if(!selected && _selected) stats.selectedNanos += now - _selectNanos;
+  _selected = selected;
+  _phase = ADDRESS; // a burst, or a half-finished access, ends with chip select
+}
+
+
+uint8_t PAW3902Sim::transfer(uint8_t mosi)
+{
+  // The bus charges the byte to the clock before asking the device, so now is
+  // the end of this byte and start is where its first clock edge fell
+  uint64_t now = hostNanos(), start = now - byteNanos;
+  uint8_t miso = 0;
+
+  switch(_phase)
+  {
+    case ADDRESS:
+      _address = mosi;
+      _addressNanos = now;
+      if(mosi & 0x80)
+      {
+        if(_lastWriteNanos && start - _lastWriteNanos < 1000ULL * PAW3902_tSWW) stats.tSWWViolations++;
+        _phase = WRITE_DATA;
+        break;
+      }
+      if(_lastReadNanos && start - _lastReadNanos < 1000ULL * PAW3902_tSRR) stats.tSRRViolations++;
+      if(mosi == 0x16)
+      {
+        stats.bursts++;
+        if(_bank != 0) stats.bankedBursts++;
+        latchMotion();
+        _burst[0] = _regs[0][0x02];
+        _burst[1] = _regs[0][0x15];
+        for(uint8_t ii = 0; ii < 8; ii++) _burst[2 + ii] = _regs[0][0x03 + ii];
+        _burst[10] = _regs[0][0x0C]; // shutter upper first
+        _burst[11] = _regs[0][0x0B];
+        _burstIndex = 0;
+        _phase = BURST;
+      }
+      else _phase = READ_DATA;
+      break;
+
+    case WRITE_DATA:
+      stats.writes++;
+      write(_address & 0x7F, mosi);
+      _lastWriteNanos = now;
+      _phase = ADDRESS;
+      break;
+
+    case READ_DATA:
+      if(start - _addressNanos < 1000ULL * PAW3902_tSRAD) stats.tSRADViolations++;
+      stats.reads++;
+      miso = read(_address);
+      _lastReadNanos = now;
+      _phase = ADDRESS;
+      break;
+
+    case BURST:
+      if(_burstIndex == 0 && start - _addressNanos < 1000ULL * PAW3902_tSRAD) stats.tSRADViolations++;
+      miso = (_burstIndex < sizeof(_burst) && !_shutdown) ? _burst[_burstIndex] : 0;
+      _burstIndex++;
+      _lastReadNanos = now;
+      break;
+  }
+  return miso;
+}
+
+
+void PAW3902Sim::write(uint8_t address, uint8_t value)
+{
+  if(address == 0x7F)
+  {
+    _bank = value % PAW3902SIM_BANKS;
+    return;
+  }
+  if(_bank == 0 && address == 0x3A && value == 0x5A) { powerOnReset(); return; }
+  if(_shutdown) return;
+  if(_bank == 0 && address == 0x3B && value == 0xB6) { _shutdown = true; return; }
+  if(_bank == 0 && address == 0x58 && value == 0xFF)
+  {
+    _grabbing = true;
+    _upper = true;
+    _pixel = 0;
+    return;
+  }
+  _regs[_bank][address] = value;
+}
+
+
+uint8_t PAW3902Sim::read(uint8_t address)
+{
+  if(_shutdown) return 0;
+  if(address == 0x7F) return _bank;
+  if(_bank == 0)
+  {
+    if(address == 0x02) latchMotion();
+    if(address == 0x58) return framePoll();
+  }
+  return _regs[_bank][address];
+}
+
+
+// Motion and Delta_X/Y take the motion accumulated since the last latch
+void PAW3902Sim::latchMotion()
+{
+  int16_t dx = _accX > 32767 ? 32767 : _accX < -32768 ? -32768 : (int16_t)_accX;
+  int16_t dy = _accY > 32767 ? 32767 : _accY < -32768 ? -32768 : (int16_t)_accY;
+  uint8_t *r = _regs[0];
+
+  r[0x02] = (dx || dy) ? 0x80 : 0x00;
+  r[0x03] = (uint16_t)dx & 0xFF;
+  r[0x04] = (uint16_t)dx >> 8;
+  r[0x05] = (uint16_t)dy & 0xFF;
+  r[0x06] = (uint16_t)dy >> 8;
+  r[0x07] = _SQUAL;
+  r[0x08] = _rawDataSum;
+  r[0x09] = 0xFF; // maximum raw data
+  r[0x0A] = 0x00; // minimum raw data
+  r[0x0B] = _shutter & 0xFF;
+  r[0x0C] = (_shutter >> 8) & 0x1F;
+  _accX = _accY = 0;
+}
+
+
+uint8_t PAW3902Sim::framePoll()
+{
+  if(!_grabbing) return 0;
+  stats.framePolls++;
+
+  _lcg = _lcg * 1103515245u + 12345u;
+  if(_notReadyOneIn && (_lcg >> 16) % _notReadyOneIn == 0) { stats.frameNotReady++; return 0x00; }
+
+  uint8_t value = _frame[_pixel];
+  if(_upper) { _upper = false; return 0x40 | (value >> 2); }
+  _upper = true;
+  if(++_pixel == 35*35) _grabbing = false;
+  return 0x80 | ((value & 0x03) << 2);
+}
+
+
+void PAW3902Sim::addMotion(int16_t deltaX, int16_t deltaY)
+{
+  _accX += deltaX;
+  _accY += deltaY;
+}
+
+
+void PAW3902Sim::setImageQuality(uint8_t SQUAL, uint8_t rawDataSum, uint16_t shutter)
+{
+  _SQUAL = SQUAL;
+  _rawDataSum = rawDataSum;
+  _shutter = shutter & 0x1FFF;
+}
+
+
+void PAW3902Sim::setFrame(const uint8_t *pixels) { memcpy(_frame, pixels, sizeof(_frame)); }
+void PAW3902Sim::setFrameNotReady(uint8_t oneIn) { _notReadyOneIn = oneIn; }
@@ -0,0 +1,98 @@
+/* Register-level PAW3902 model for the host SPI bus.
+ *
+ * Decodes the SPI protocol the way the sensor does: the first byte after
+ * chip select is an address (bit 7 set for a write), a write carries one
+ * value, a read returns one, and several accesses may follow under the same
+ * chip select. Register 0x16 streams the 12-byte motion burst until chip
+ * select rises.
+ *
+ * Modeled:
+ *  - banks selected through 0x7F, one 128-register file per bank
+ *  - product ID 0x49 at 0x00 and its inverse 0xB6 at 0x5F
+ *  - power-on reset (0x3A = 0x5A) and shutdown (0x3B = 0xB6)
+ *  - motion registers 0x02-0x0C: motion injected with addMotion() accumulates
+ *    until reading Motion (0x02) or the burst latches and clears it
+ *  - the frame capture handshake: writing 0xFF to 0x58 starts a 35 x 35 grab
+ *    and each 0x58 read returns the next upper (01xxxxxx) or lower (10xxxx00)
+ *    half, or 0 while the pixel is not ready
+ *  - timing: tSRAD, tSRR and tSWW from PAW3902Tables.h are checked against
+ *    the virtual clock and breaches counted, the data itself is not corrupted
+ */
+
+#ifndef __HOST_PAW3902SIM_H
+#define __HOST_PAW3902SIM_H
+
+#include "Arduino.h"
+#include "SPI.h"
+
+#define PAW3902SIM_BANKS 32
+
+struct PAW3902SimStats {
+  uint32_t selects;         // chip select assertions
+  uint32_t writes;          // register writes
+  uint32_t reads;           // register reads, 0x58 polls included
+  uint32_t bursts;          // 0x16 motion bursts
+  uint32_t bankedBursts;    // ... read with a bank other than 0 selected, another register on the sensor
+  uint32_t framePolls;      // 0x58 reads during a grab
+  uint32_t frameNotReady;   // ... answered "not ready"
+  uint32_t resets;
+  uint32_t tSRADViolations; // address to data gap of a read too short
+  uint32_t tSRRViolations;  // read to next read gap too short
+  uint32_t tSWWViolations;  // write to next write gap too short
+  uint64_t selectedNanos;   // time with chip select low
+};
+
+class PAW3902Sim : public HostSPIDevice {
+public:
+  PAW3902Sim();
+
+  void select(bool selected);
+  uint8_t transfer(uint8_t mosi);
+
+  // Scene
+  void addMotion(int16_t deltaX, int16_t deltaY);
+  void setImageQuality(uint8_t SQUAL, uint8_t rawDataSum, uint16_t shutter);
+  void setFrame(const uint8_t *pixels);       // 35 x 35, copied
+  void setFrameNotReady(uint8_t oneIn);       // 0x58 not ready on about one poll in oneIn, 0 = never
+
+  // Inspection
+  uint8_t reg(uint8_t bank, uint8_t address) const { return _regs[bank % PAW3902SIM_BANKS][address & 0x7F]; }
+  const uint8_t *registerFile(uint8_t bank) const { return _regs[bank % PAW3902SIM_BANKS]; }
+  bool isShutdown() const { return _shutdown; }
+  bool grabbing() const { return _grabbing; }
+
+  PAW3902SimStats stats;
+  void resetStats() { memset(&stats, 0, sizeof(stats)); }
+
+private:
+  void powerOnReset();
+  uint8_t read(uint8_t address);
+  void write(uint8_t address, uint8_t value);
+  void latchMotion();
+  uint8_t framePoll();
+
+  enum Phase { ADDRESS, WRITE_DATA, READ_DATA, BURST };
+
+  uint8_t _regs[PAW3902SIM_BANKS][128];
+  uint8_t _bank;
+  bool _shutdown;
+
+  bool _selected;
+  Phase _phase;
+  uint8_t _address;
+  uint8_t _burst[12];
+  uint8_t _burstIndex;
+  uint64_t _addressNanos, _lastReadNanos, _lastWriteNanos, _selectNanos;
+
+  int32_t _accX, _accY;
+  uint8_t _SQUAL, _rawDataSum;
+  uint16_t _shutter;
+
+  uint8_t _frame[35*35];
+  bool _grabbing, _upper;
+  uint16_t _pixel;
+  uint8_t _notReadyOneIn;
+  uint32_t _lcg;
+};
+
+#endif //__HOST_PAW3902SIM_H
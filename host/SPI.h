@@ -0,0 +1,67 @@
+/* Host-side stand-in for the Arduino SPI library. Every byte and transaction
+ * is counted and charged to the virtual clock at the configured SPI rate.
+ * HostSPIDevices attached on their own chip select pins answer MISO while
+ * selected; with none selected the bus reads 0.
+ */
+
+#ifndef __HOST_SPI_H
+#define __HOST_SPI_H
+
+#include "Arduino.h"
+
+#define MSBFIRST  1
+#define LSBFIRST  0
+#define SPI_MODE0 0
+#define SPI_MODE3 3
+
+#define HOST_SPI_DEVICES 8 // devices per SPIClass
+
+class SPISettings {
+public:
+  SPISettings(uint32_t clock = 4000000, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0)
+    : clock(clock), bitOrder(bitOrder), dataMode(dataMode) { }
+  uint32_t clock;
+  uint8_t bitOrder, dataMode;
+};
+
+// Simulated peripheral on the bus. Whoever drives it charges each byte to
+// the clock before calling transfer() and keeps byteNanos current.
+class HostSPIDevice {
+public:
+  HostSPIDevice() : byteNanos(0) { }
+  virtual ~HostSPIDevice() { }
+  virtual void select(bool selected) = 0;   // chip select edge
+  virtual uint8_t transfer(uint8_t mosi) = 0;
+  uint32_t byteNanos;                       // time to clock the byte being transferred
+};
+
+class SPIClass {
+public:
+  void begin() { }
+  void end() { }
+  void usingInterrupt(uint8_t pin) { (void)pin; }
+  void beginTransaction(SPISettings settings);
+  void endTransaction();
+  uint8_t transfer(uint8_t data);
+  void transfer(void *buffer, size_t count);
+
+  void attach(HostSPIDevice *device, uint8_t cspin); // replaces whatever was on cspin
+  void chipSelect(uint8_t pin, uint8_t value); // called from digitalWrite()
+  uint32_t nanosPerByte() const { return _nanosPerByte; }
+  void resetCounters() { transactions = 0; bytes = 0; busNanos = 0; }
+
+  uint32_t transactions; // beginTransaction() calls
+  uint32_t bytes;        // bytes clocked
+  uint64_t busNanos;     // modeled time spent clocking them
+
+private:
+  HostSPIDevice *_devices[HOST_SPI_DEVICES];
+  uint8_t _pins[HOST_SPI_DEVICES];
+  uint8_t _attached;
+  HostSPIDevice *_device; // selected one
+  uint32_t _nanosPerByte;
+};
+
+extern SPIClass SPI;
+
+#endif //__HOST_SPI_H
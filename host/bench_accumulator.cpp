@@ -0,0 +1,54 @@
+/* Per-sample cost of motionAccumulate() next to motionRingPush().
+ *
+ * Unlike the other benches this one measures real host time with
+ * steady_clock, since neither path touches the bus. Numbers are only a
+ * relative guide for the MCU builds.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include "MotionRing.h"
+#include "MotionAccumulator.h"
+
+#define SAMPLES 10000000UL
+#define TAKE_EVERY 64 // samples summed between consumer reads
+
+static MotionAccumulator acc;
+static MotionRing ring;
+
+int main()
+{
+  PAW3902Sample sample = {};
+  MotionTotals totals = {};
+  int64_t sumX = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for(unsigned long i = 0; i < SAMPLES; i++)
+  {
+    sample.timestamp = i * 8000;
+    sample.deltaX = (int16_t)((i * 37) & 0xFF) - 128;
+    sample.deltaY = (int16_t)((i * 91) & 0xFF) - 128;
+    sample.SQUAL  = (uint8_t)(i * 13);
+    motionAccumulate(&acc, &sample);
+    if((i % TAKE_EVERY) == TAKE_EVERY - 1)
+    {
+      motionTake(&acc, &totals);
+      sumX += totals.deltaX;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for(unsigned long i = 0; i < SAMPLES; i++)
+  {
+    sample.timestamp = i * 8000;
+    motionRingPush(&ring, &sample);
+    if((i % TAKE_EVERY) == TAKE_EVERY - 1) while(motionRingPop(&ring, &sample)) sumX += sample.deltaX;
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  double accNs  = std::chrono::duration<double, std::nano>(t1 - t0).count() / SAMPLES;
+  double ringNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / SAMPLES;
+  printf("motionAccumulate  %6.2f ns/sample (take every %d)\n", accNs, TAKE_EVERY);
+  printf("motionRingPush    %6.2f ns/sample (drain every %d)\n", ringNs, TAKE_EVERY);
+  printf("checksum %lld\n", (long long)sumX);
+  return 0;
+}
@@ -0,0 +1,221 @@
+/* Confidence weighting against hard zeroing, replayed through VelocityEstimator.
+ *
+ * Each trace runs three ways:
+ *
+ *  - zeroed:   counts under the lightModeValid() thresholds set to 0, every
+ *              sample at full weight; what a filter behind the old gate saw
+ *  - gated:    those samples only advance the prediction, the rest at full weight
+ *  - weighted: every sample at its lightModeRate() confidence
+ *
+ * and is scored against the true velocity: RMS error over the run, RMS over
+ * the poor samples (gated or confidence under half) and how far the
+ * integrated velocity ends from the true track.
+ *
+ * Without an argument the trace is synthetic: the flight of bench_velocity
+ * over a poor surface, a dark patch under the gate, a bright featureless
+ * patch that passes it, and a stretch in lowlight. With one, it is a
+ * recorded trace (one sample per line: timestamp deltaX deltaY SQUAL
+ * RawDataSum Shutter mode, as telemetry_decode prints) whose timing, modes
+ * and image quality are replayed; its counts are regenerated from the same
+ * flight, since a recording has no true velocity to score against.
+ *
+ * Counts follow image quality, not the confidence formula: noise grows as
+ * SQUAL falls under 100 and the sensor loses track under SQUAL 30, reading
+ * short of the true motion.
+ *
+ *   g++ -std=c++11 -O2 -IPAW3902 host/bench_confidence.cpp -o bench_confidence
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "VelocityEstimator.h"
+#include "LightModeController.h"
+#include "BenchRandom.h"
+
+#define HEIGHT_MM 1000
+#define TIMED     0.3 // seconds for the timing run
+
+// True velocity in m/s at t s, repeating every 12 s
+static void truth(double t, double *vx, double *vy)
+{
+  t = fmod(t, 12);
+  if(t < 2) *vx = 0.75 * t;
+  else if(t < 5) *vx = 1.5;
+  else if(t < 9) *vx = 1.5 + sin(2 * M_PI * 0.5 * (t - 5));
+  else if(t < 10.5) *vx = 1.5 * (10.5 - t) / 1.5;
+  else *vx = 0;
+  *vy = t < 10.5 ? 0.4 * sin(2 * M_PI * 0.2 * t) : 0;
+}
+
+struct Quality { uint8_t SQUAL, RawDataSum, mode; uint16_t Shutter; };
+
+static Quality synthetic(double t)
+{
+  if(t >= 2.5 && t < 3.5) return { 45, 0x40, 0, 0x0400 };  // poor surface, passes the gate
+  if(t >= 4 && t < 4.6)   return { 18, 0x10, 0, 0x1FFF };  // dark patch, under the gate
+  if(t >= 6 && t < 6.5)   return { 15, 0x80, 0, 0x0200 };  // bright and featureless, passes the gate
+  if(t >= 8 && t < 8.8)   return { 80, 0x30, 1, 0x1000 };  // lowlight
+  return { 120, 0x40, 0, 0x0400 };
+}
+
+struct Entry { PAW3902Sample sample; double vx, vy; };
+
+// Counts for the true motion over dt s under the sample's image quality
+static void count(PAW3902Sample *s, double t, double dt, double mmPerCount, double *carryX, double *carryY)
+{
+  double vx0, vy0, vx1, vy1;
+  truth(t - dt, &vx0, &vy0);
+  truth(t, &vx1, &vy1);
+  double track = s->SQUAL >= 30 ? 1.0 : s->SQUAL / 30.0;
+  double sigma = 0.5 * (s->SQUAL < 100 ? 100.0 / (s->SQUAL < 5 ? 5 : s->SQUAL) : 1.0);
+  *carryX += track * (vx0 + vx1) / 2 * dt * 1000 / mmPerCount + sigma * gaussian();
+  *carryY += track * (vy0 + vy1) / 2 * dt * 1000 / mmPerCount + sigma * gaussian();
+  s->deltaX = (int16_t)lround(*carryX);
+  s->deltaY = (int16_t)lround(*carryY);
+  *carryX -= s->deltaX;
+  *carryY -= s->deltaY;
+}
+
+static bool load(const char *path, std::vector<Entry> &trace, double mmPerCount)
+{
+  FILE *f = fopen(path, "r");
+  if(!f) { perror(path); return false; }
+  unsigned long t, squal, raw, shutter, mode, t0 = 0;
+  long dx, dy;
+  double carryX = 0, carryY = 0, last = 0;
+  while(fscanf(f, "%lu %ld %ld %lu %lu %lu %lu", &t, &dx, &dy, &squal, &raw, &shutter, &mode) == 7)
+  {
+    if(trace.empty()) t0 = t;
+    Entry e = {};
+    double now = (uint32_t)(t - t0) / 1e6;
+    e.sample.timestamp = (uint32_t)(t - t0) + 1000;
+    e.sample.SQUAL = squal;
+    e.sample.RawDataSum = raw;
+    e.sample.Shutter = shutter;
+    e.sample.mode = mode;
+    count(&e.sample, now, now - last, mmPerCount, &carryX, &carryY);
+    truth(now, &e.vx, &e.vy);
+    trace.push_back(e);
+    last = now;
+  }
+  fclose(f);
+  return !trace.empty();
+}
+
+static void generate(std::vector<Entry> &trace, double mmPerCount)
+{
+  double t = 0, carryX = 0, carryY = 0;
+  while(t < 12)
+  {
+    double dt = (t >= 10.8 && t < 11.2) ? 0.25 : 0.008 + 0.002 * (uniform() - 0.5); // no motion interrupts while stopped
+    t += dt;
+    Quality q = synthetic(t);
+    Entry e = {};
+    e.sample.timestamp = (uint32_t)lround(t * 1e6) + 1000;
+    e.sample.SQUAL = q.SQUAL;
+    e.sample.RawDataSum = q.RawDataSum;
+    e.sample.Shutter = q.Shutter;
+    e.sample.mode = q.mode;
+    count(&e.sample, t, dt, mmPerCount, &carryX, &carryY);
+    truth(t, &e.vx, &e.vy);
+    trace.push_back(e);
+  }
+}
+
+enum Policy { ZEROED, GATED, WEIGHTED };
+static const char *policyName[] = { "zeroed", "gated", "weighted" };
+
+struct Score { double rms, poorRms, drift; };
+
+static Score replay(const std::vector<Entry> &trace, Policy policy)
+{
+  LightModeController lightMode;
+  lightModeInit(&lightMode, NULL);
+  VelocityEstimator est;
+  velocityInit(&est, NULL, HEIGHT_MM);
+
+  double err = 0, poorErr = 0, driftX = 0, driftY = 0;
+  uint32_t counted = 0, poor = 0, last = trace[0].sample.timestamp;
+  for(size_t ii = 0; ii < trace.size(); ii++)
+  {
+    PAW3902Sample rated = trace[ii].sample, s;
+    lightModeRate(&lightMode, &rated);
+    s = rated;
+    if(policy == ZEROED)
+    {
+      if(!s.valid) s.deltaX = s.deltaY = 0;
+      s.confidence = 255;
+    }
+    else if(policy == GATED) s.confidence = s.valid ? 255 : 0;
+    velocityUpdate(&est, &s);
+
+    double dt = (uint32_t)(s.timestamp - last) / 1e6;
+    last = s.timestamp;
+    double vx = est.vx / 65536.0, vy = est.vy / 65536.0;
+    driftX += (vx - trace[ii].vx) * dt;
+    driftY += (vy - trace[ii].vy) * dt;
+    if(trace[ii].sample.timestamp < 500000 || dt * 1e6 > velocityDefaults.maxGapMicros) continue;
+    double e = pow(vx - trace[ii].vx, 2) + pow(vy - trace[ii].vy, 2);
+    err += e;
+    counted++;
+    if(!rated.valid || rated.confidence < 128)
+    {
+      poorErr += e;
+      poor++;
+    }
+  }
+  Score score = { sqrt(err / counted), poor ? sqrt(poorErr / poor) : 0, hypot(driftX, driftY) };
+  return score;
+}
+
+int main(int argc, char **argv)
+{
+  double mmPerCount = HEIGHT_MM * velocityDefaults.microradPerCount / 1e6;
+  std::vector<Entry> trace;
+  if(argc > 1)
+  {
+    if(!load(argv[1], trace, mmPerCount)) return 1;
+  }
+  else generate(trace, mmPerCount);
+
+  LightModeController lightMode;
+  lightModeInit(&lightMode, NULL);
+  uint32_t gated = 0, low = 0;
+  for(size_t ii = 0; ii < trace.size(); ii++)
+  {
+    PAW3902Sample s = trace[ii].sample;
+    lightModeRate(&lightMode, &s);
+    gated += !s.valid;
+    low += s.valid && s.confidence < 128;
+  }
+  printf("%s trace: %zu samples, %lu under the thresholds, %lu passing them at confidence under half\n",
+         argc > 1 ? argv[1] : "synthetic", trace.size(), (unsigned long)gated, (unsigned long)low);
+
+  printf("%-9s %14s %14s %14s\n", "policy", "RMS m/s", "poor RMS m/s", "track drift m");
+  Score scores[3];
+  for(int policy = ZEROED; policy <= WEIGHTED; policy++)
+  {
+    scores[policy] = replay(trace, (Policy)policy);
+    printf("%-9s %14.4f %14.4f %14.3f\n", policyName[policy], scores[policy].rms, scores[policy].poorRms, scores[policy].drift);
+  }
+
+  // Cost of rating one sample
+  uint32_t calls = 0;
+  double elapsed;
+  volatile uint32_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  do
+  {
+    for(size_t ii = 0; ii < trace.size(); ii++, calls++)
+    {
+      PAW3902Sample s = trace[ii].sample;
+      lightModeRate(&lightMode, &s);
+      sink = sink + s.confidence;
+    }
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  } while(elapsed < TIMED);
+  printf("lightModeRate(): %.1f ns per sample on this host\n", elapsed * 1e9 / calls);
+  return argc > 1 || scores[WEIGHTED].rms <= scores[GATED].rms ? 0 : 1;
+}
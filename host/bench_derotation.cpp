@@ -0,0 +1,257 @@
+/* FlowDerotation.h on synthetic gyro and flow traces: how much of the
+ * rotation it takes out of the counts, what that does for the velocity
+ * estimate, and the cost per burst on this host.
+ *
+ * A sensor 1 m up translates at a few tenths of a m/s while the airframe
+ * rocks at up to about 3 rad/s. Bursts come about every 8 ms and count the
+ * motion of an interval ending LAG_US before they are read; the gyro reports
+ * at 1 kHz with jitter and noise. Counts carry their rounding remainder, as
+ * the sensor does. A second trace holds the sensor still for 2 s, with no
+ * bursts while the gyro keeps reporting a small bias, to check the first
+ * burst after the pause restarts instead of taking the pause as rotation.
+ *
+ *   g++ -std=c++11 -O2 -IPAW3902 host/bench_derotation.cpp -o bench_derotation
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "FlowDerotation.h"
+#include "VelocityEstimator.h"
+#include "BenchRandom.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define HEIGHT_MM 1000
+#define LAG_US    2000
+#define RUN_S     10.0
+#define TIMED     0.5 // seconds for the timing runs
+
+// Sums of sines: rate and its integral
+struct Motion {
+  double a[2], f[2], p[2];
+  double rate(double t) const { return a[0] * sin(2 * M_PI * f[0] * t + p[0]) + a[1] * sin(2 * M_PI * f[1] * t + p[1]); }
+  double integral(double t) const
+  {
+    return -a[0] / (2 * M_PI * f[0]) * cos(2 * M_PI * f[0] * t + p[0]) - a[1] / (2 * M_PI * f[1]) * cos(2 * M_PI * f[1] * t + p[1]);
+  }
+};
+
+static const Motion rollRate  = { { 2.0, 0.8 }, { 1.3, 4.1 }, { 0, 0.5 } };  // rad/s about gyro X
+static const Motion pitchRate = { { 1.5, 0.6 }, { 0.9, 3.3 }, { 1.0, 2.0 } }; // about gyro Y
+static const Motion speedX    = { { 0.6, 0.2 }, { 0.2, 0.7 }, { 0, 1.0 } };   // m/s
+static const Motion speedY    = { { 0.4, 0.1 }, { 0.15, 0.5 }, { 2.0, 0 } };
+
+struct Event { bool burst; GyroSample gyro; PAW3902Sample sample; double trueX, trueY, vx, vy; };
+
+static std::vector<Event> trace;
+
+static void record()
+{
+  const double mmPerCount = HEIGHT_MM * derotateDefaults.microradPerCount / 1e6;
+  const double countsPerRad = 1e6 / derotateDefaults.microradPerCount;
+  double gyroT = 0.001, burstT = 0.008, lastEnd = burstT - LAG_US * 1e-6, carryX = 0, carryY = 0;
+  bool first = true;
+  while(burstT < RUN_S)
+  {
+    Event e = {};
+    if(gyroT <= burstT)
+    {
+      double t = gyroT + 50e-6 * (uniform() - 0.5);
+      e.burst = false;
+      e.gyro.timestamp = (uint32_t)lround(t * 1e6);
+      e.gyro.rateX = (int32_t)lround((rollRate.rate(t) + 0.01 * gaussian()) * 65536);
+      e.gyro.rateY = (int32_t)lround((pitchRate.rate(t) + 0.01 * gaussian()) * 65536);
+      gyroT += 0.001;
+    }
+    else
+    {
+      double end = burstT - LAG_US * 1e-6;
+      double tx = (speedX.integral(end) - speedX.integral(lastEnd)) * 1000 / mmPerCount; // translation counts
+      double ty = (speedY.integral(end) - speedY.integral(lastEnd)) * 1000 / mmPerCount;
+      double rx = (pitchRate.integral(end) - pitchRate.integral(lastEnd)) * countsPerRad;  // default mapping
+      double ry = -(rollRate.integral(end) - rollRate.integral(lastEnd)) * countsPerRad;
+      carryX += tx + rx + 0.3 * gaussian();
+      carryY += ty + ry + 0.3 * gaussian();
+      e.burst = true;
+      e.sample.timestamp = (uint32_t)lround(burstT * 1e6);
+      e.sample.deltaX = (int16_t)lround(carryX);
+      e.sample.deltaY = (int16_t)lround(carryY);
+      e.sample.SQUAL = 120;
+      e.sample.confidence = 255;
+      e.sample.valid = 1;
+      carryX -= e.sample.deltaX;
+      carryY -= e.sample.deltaY;
+      e.trueX = first ? e.sample.deltaX : tx;
+      e.trueY = first ? e.sample.deltaY : ty;
+      e.vx = speedX.rate(end);
+      e.vy = speedY.rate(end);
+      first = false;
+      lastEnd = end;
+      burstT += 0.008 + 0.002 * (uniform() - 0.5);
+    }
+    trace.push_back(e);
+  }
+}
+
+struct Result { double rms, drift, velocity; uint32_t uncovered; };
+
+// Replays the trace; lag < 0 leaves the counts as they are
+static Result replay(int32_t lag)
+{
+  DerotateConfig config = derotateDefaults;
+  config.lagMicros = lag < 0 ? 0 : (uint32_t)lag;
+  FlowDerotator d;
+  flowDerotateInit(&d, &config);
+  VelocityEstimator est;
+  velocityInit(&est, NULL, HEIGHT_MM);
+
+  double err = 0, sumX = 0, sumY = 0, trueSumX = 0, trueSumY = 0, verr = 0;
+  uint32_t bursts = 0, vcount = 0;
+  for(size_t ii = 0; ii < trace.size(); ii++)
+  {
+    if(!trace[ii].burst) { gyroPush(&d, &trace[ii].gyro); continue; }
+    PAW3902Sample s = trace[ii].sample;
+    if(lag >= 0) flowDerotate(&d, &s);
+    velocityUpdate(&est, &s);
+    err += pow(s.deltaX - trace[ii].trueX, 2) + pow(s.deltaY - trace[ii].trueY, 2);
+    sumX += s.deltaX; sumY += s.deltaY;
+    trueSumX += trace[ii].trueX; trueSumY += trace[ii].trueY;
+    bursts++;
+    if(s.timestamp > 1000000)
+    {
+      verr += pow(est.vx / 65536.0 - trace[ii].vx, 2) + pow(est.vy / 65536.0 - trace[ii].vy, 2);
+      vcount++;
+    }
+  }
+  Result r = { sqrt(err / bursts), hypot(sumX - trueSumX, sumY - trueSumY), sqrt(verr / vcount), d.uncovered };
+  return r;
+}
+
+// 2 rad/s about gyro Y with bursts every 8 ms, then PAUSE_US still with no
+// bursts, then the turn again; the gyro reads 0.05 rad/s high throughout.
+// idle calls flowDerotateIdle() every 10 ms meanwhile, as a loop would.
+// Returns the counts of the first burst after the pause, which holds 8 ms of
+// turn, and the worst of those after it, where nothing should be left.
+#define PAUSE_US 2000000
+static void pauseCheck(bool idle, FlowDerotator * d, int32_t * first, int32_t * worst)
+{
+  DerotateConfig config = derotateDefaults;
+  config.lagMicros = 0;
+  flowDerotateInit(d, &config);
+  const double countsPerUs = 2.0 / config.microradPerCount; // 2 rad/s
+  const uint32_t pauseFrom = 504000, pauseTo = pauseFrom + PAUSE_US;
+  uint32_t gyroT = 1000, burstT = 8000, lastBurst = 0, nextIdle = pauseFrom;
+  double carry = 0;
+  *first = *worst = 0;
+  while(burstT < pauseTo + 500000)
+  {
+    if(gyroT <= burstT)
+    {
+      bool turning = gyroT <= pauseFrom || gyroT >= pauseTo - 8000;
+      GyroSample g = { gyroT, 0, (turning ? 2 * 65536 : 0) + VELOCITY_Q16(0.05) };
+      gyroPush(d, &g);
+      if(idle && gyroT >= nextIdle && gyroT < pauseTo) { flowDerotateIdle(d, gyroT); nextIdle += 10000; }
+      gyroT += 1000;
+      continue;
+    }
+    PAW3902Sample s = {};
+    uint32_t from = lastBurst == pauseFrom ? pauseTo - 8000 : lastBurst; // still in between
+    carry += (burstT - from) * countsPerUs; // all of it rotation, the ground is still
+    s.timestamp = burstT;
+    s.deltaX = (int16_t)lround(carry);
+    carry -= s.deltaX;
+    flowDerotate(d, &s);
+    if(burstT == pauseTo) *first = s.deltaX;
+    else if(burstT > pauseTo && abs(s.deltaX) > *worst) *worst = abs(s.deltaX);
+    lastBurst = burstT;
+    burstT = burstT == pauseFrom ? pauseTo : burstT + 8000;
+  }
+}
+
+int main()
+{
+  record();
+  size_t bursts = 0;
+  for(size_t ii = 0; ii < trace.size(); ii++) bursts += trace[ii].burst;
+
+  Result raw = replay(-1), lag0 = replay(0), matched = replay(LAG_US);
+  printf("%zu bursts, %zu gyro samples over %.0f s, sensor lag %d us\n", bursts, trace.size() - bursts, RUN_S, LAG_US);
+  printf("%-28s %14s %14s %14s %10s\n", "", "counts RMS", "drift, counts", "velocity RMS", "uncovered");
+  printf("%-28s %14.2f %14.1f %13.3f %10s\n", "raw counts", raw.rms, raw.drift, raw.velocity, "");
+  printf("%-28s %14.2f %14.1f %13.3f %10lu\n", "derotated, lagMicros 0", lag0.rms, lag0.drift, lag0.velocity, (unsigned long)lag0.uncovered);
+  printf("%-28s %14.2f %14.1f %13.3f %10lu\n", "derotated, lagMicros matched", matched.rms, matched.drift, matched.velocity,
+         (unsigned long)matched.uncovered);
+  printf("(counts per burst against the true translation; velocity in m/s)\n\n");
+
+  FlowDerotator paused, drained;
+  int32_t pausedFirst, pausedWorst, drainedFirst, drainedWorst;
+  pauseCheck(false, &paused, &pausedFirst, &pausedWorst);
+  pauseCheck(true, &drained, &drainedFirst, &drainedWorst);
+  printf("%-28s %14s %14s %10s %10s %10s\n", "still for 2 s, then a turn", "first burst", "worst after", "restarts", "uncovered",
+         "overruns");
+  printf("%-28s %14ld %14ld %10lu %10lu %10lu\n", "bursts only", (long)pausedFirst, (long)pausedWorst, (unsigned long)paused.restarts,
+         (unsigned long)paused.uncovered, (unsigned long)paused.overruns);
+  printf("%-28s %14ld %14ld %10lu %10lu %10lu\n", "with flowDerotateIdle()", (long)drainedFirst, (long)drainedWorst,
+         (unsigned long)drained.restarts, (unsigned long)drained.uncovered, (unsigned long)drained.overruns);
+  printf("(counts after derotation; the first burst passes its 8 counts of turn as is)\n\n");
+  bool pauseFine = paused.restarts == 1 && drained.restarts == 1 && abs(pausedFirst) <= 8 && abs(drainedFirst) <= 8 &&
+                   pausedWorst <= 1 && drainedWorst <= 1;
+
+  // Cost: whole replay, then the pushes alone
+  FlowDerotator d;
+  uint32_t passes = 0;
+  uint64_t cycles = 0, pushCycles = 0;
+  double all = 0, push = 0;
+  volatile int32_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  do
+  {
+    flowDerotateInit(&d, NULL);
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t c0 = __rdtsc();
+#endif
+    for(size_t ii = 0; ii < trace.size(); ii++)
+    {
+      if(!trace[ii].burst) { gyroPush(&d, &trace[ii].gyro); continue; }
+      PAW3902Sample s = trace[ii].sample;
+      flowDerotate(&d, &s);
+      sink = sink + s.deltaX;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    cycles += __rdtsc() - c0;
+#endif
+    passes++;
+    all = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  } while(all < TIMED);
+
+  uint32_t pushPasses = 0;
+  t0 = std::chrono::steady_clock::now();
+  do
+  {
+    flowDerotateInit(&d, NULL);
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t c0 = __rdtsc();
+#endif
+    for(size_t ii = 0; ii < trace.size(); ii++)
+      if(!trace[ii].burst) { gyroPush(&d, &trace[ii].gyro); d.tail = d.head; }
+#if defined(__x86_64__) || defined(__i386__)
+    pushCycles += __rdtsc() - c0;
+#endif
+    pushPasses++;
+    push = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  } while(push < TIMED);
+
+  double gyroCount = (double)(trace.size() - bursts);
+  double pushNs = push * 1e9 / pushPasses / gyroCount;
+  double burstNs = (all * 1e9 / passes - pushNs * gyroCount) / bursts;
+  printf("gyroPush(): %.1f ns, flowDerotate(): %.1f ns per burst", pushNs, burstNs);
+  if(cycles)
+    printf(" (%.0f / %.0f TSC cycles)", (double)pushCycles / pushPasses / gyroCount,
+           ((double)cycles / passes - (double)pushCycles / pushPasses) / bursts);
+  printf(" on this host\n");
+  return matched.rms < raw.rms && pauseFine ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+/* Driver hot paths against the register-level sensor model (PAW3902Sim).
+ *
+ * Each row is one driver call with its modeled wall time, the part spent
+ * clocking bytes, chip select low time, deliberate waits, bus traffic and
+ * any SPI timing breaches the model saw. The run also checks what the
+ * driver did: the product ID, decoded burst and motion registers against the
+ * motion injected, captured pixels against the model's frame, and that a hot
+ * switchMode() leaves the same register file as a full setMode(). One row
+ * polls bursts with a little work in between, as a sketch loop would.
+ *
+ * The whole run is made twice: through the Arduino library (PAW3902 on the
+ * SPI stand-in), then through PAW3902Core on PAW3902HostBus, which drives the
+ * model directly and so shows what the sensor's own timing costs.
+ *
+ * Exits non-zero if any check fails, so it can run unattended.
+ */
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "PAW3902.h"
+#include "PAW3902Sim.h"
+#include "PAW3902HostBus.h"
+
+#define CSPIN 10
+
+PAW3902Sim sensor;
+PAW3902 opticalFlow(CSPIN);
+PAW3902Core<PAW3902HostBus> hostFlow((PAW3902HostBus(&sensor)));
+static int failures = 0;
+
+static const char *modeName[] = { "bright", "lowlight", "superlowlight" };
+
+static uint64_t t0, w0;
+
+// Bus counters of either driver
+static SPIClass &bus(PAW3902 &) { return SPI; }
+static PAW3902HostBus &bus(PAW3902Core<PAW3902HostBus> &flow) { return flow.bus(); }
+
+template <class Driver>
+static void start(Driver &flow)
+{
+  bus(flow).resetCounters();
+  sensor.resetStats();
+  t0 = hostNanos();
+  w0 = hostDelayNanos();
+}
+
+template <class Driver>
+static void report(Driver &flow, const char *name)
+{
+  uint64_t wall = hostNanos() - t0, wait = hostDelayNanos() - w0;
+  const PAW3902SimStats &s = sensor.stats;
+  uint32_t violations = s.tSRADViolations + s.tSRRViolations + s.tSWWViolations;
+  printf("%-36s %10.1f %9.1f %9.1f %10.1f %5u %6u %5lu\n", name, wall / 1000.0, bus(flow).busNanos / 1000.0,
+         s.selectedNanos / 1000.0, wait / 1000.0, bus(flow).transactions, bus(flow).bytes, (unsigned long)violations);
+  if(violations)
+    printf("%36s tSRAD %u, tSRR %u, tSWW %u\n", "", s.tSRADViolations, s.tSRRViolations, s.tSWWViolations);
+}
+
+static void check(bool ok, const char *what)
+{
+  if(ok) return;
+  printf("FAIL: %s\n", what);
+  failures++;
+}
+
+// Register file of every bank the driver touches
+static bool sameRegisters(const uint8_t saved[PAW3902SIM_BANKS][128])
+{
+  for(uint8_t bank = 0; bank < PAW3902SIM_BANKS; bank++)
+    for(uint8_t reg = 0; reg < 0x7F; reg++)
+      if(sensor.reg(bank, reg) != saved[bank][reg])
+      {
+        printf("  bank 0x%02X reg 0x%02X: 0x%02X, full sequence gives 0x%02X\n", bank, reg, sensor.reg(bank, reg), saved[bank][reg]);
+        return false;
+      }
+  return true;
+}
+
+template <class Driver>
+static void run(Driver &opticalFlow, const char *title)
+{
+  printf("%s\n%-36s %10s %9s %9s %10s %5s %6s %5s\n", title, "operation", "wall_us", "bus_us", "cs_us", "wait_us", "txns", "bytes", "viol");
+
+  start(opticalFlow);
+  bool began = opticalFlow.begin();
+  report(opticalFlow, "begin");
+  check(began && opticalFlow.getMode() == lowlight, "begin() leaves the sensor in lowlight");
+
+  start(opticalFlow);
+  bool id = opticalFlow.checkID();
+  report(opticalFlow, "checkID");
+  check(id, "checkID() sees 0x49 / 0xB6");
+
+  // Full mode sequences, and the register file each one leaves
+  static uint8_t full[3][PAW3902SIM_BANKS][128];
+  static const uint8_t order[] = { bright, superlowlight, lowlight };
+  for(uint8_t ii = 0; ii < sizeof(order); ii++)
+  {
+    char name[40];
+    snprintf(name, sizeof(name), "setMode(%s)", modeName[order[ii]]);
+    start(opticalFlow);
+    opticalFlow.setMode(order[ii]);
+    report(opticalFlow, name);
+    for(uint8_t bank = 0; bank < PAW3902SIM_BANKS; bank++) memcpy(full[order[ii]][bank], sensor.registerFile(bank), 128);
+  }
+
+  // Hot switches must land on the same registers
+  for(uint8_t from = 0; from < 3; from++)
+    for(uint8_t to = 0; to < 3; to++)
+    {
+      if(from == to) continue;
+      opticalFlow.setMode(from);
+      char name[40];
+      snprintf(name, sizeof(name), "switchMode(%s -> %s)", modeName[from], modeName[to]);
+      start(opticalFlow);
+      opticalFlow.switchMode(to);
+      report(opticalFlow, name);
+      check(sameRegisters(full[to]), name);
+    }
+
+  // Motion: burst against the individual registers
+  opticalFlow.setMode(lowlight);
+  sensor.setImageQuality(87, 0x5A, 0x0BB8);
+  sensor.addMotion(-12, 345);
+  uint8_t burst[12];
+  start(opticalFlow);
+  opticalFlow.readBurstMode(burst);
+  report(opticalFlow, "readBurstMode");
+  PAW3902Sample sample;
+  decodeBurst(burst, 0, lowlight, &sample);
+  check(sample.deltaX == -12 && sample.deltaY == 345 && sample.SQUAL == 87 && sample.RawDataSum == 0x5A &&
+        sample.Shutter == 0x0BB8 && (burst[0] & 0x80), "burst decodes the injected motion");
+
+  // A polling loop: the gap after each burst runs under the caller's work
+  start(opticalFlow);
+  for(uint8_t ii = 0; ii < 100; ii++)
+  {
+    opticalFlow.readBurstMode(burst);
+    hostAdvance(5000); // 5 us of application work
+  }
+  report(opticalFlow, "100 x (readBurstMode + 5 us work)");
+
+  sensor.addMotion(7, -3);
+  int16_t dx, dy;
+  uint8_t SQUAL;
+  uint16_t shutter;
+  start(opticalFlow);
+  uint8_t motion = opticalFlow.status();
+  opticalFlow.readMotionCount(&dx, &dy, &SQUAL, &shutter);
+  report(opticalFlow, "status + readMotionCount");
+  check((motion & 0x80) && dx == 7 && dy == -3 && SQUAL == 87 && shutter == 0x0BB8, "motion registers match the injected motion");
+
+  // Frame capture, with the sensor sometimes not ready
+  uint8_t frame[35*35];
+  sensor.setFrameNotReady(8);
+  start(opticalFlow);
+  opticalFlow.enterFrameCaptureMode();
+  report(opticalFlow, "enterFrameCaptureMode");
+  start(opticalFlow);
+  uint8_t captured = opticalFlow.captureFrame(frame);
+  report(opticalFlow, "captureFrame");
+  uint16_t errors = 0;
+  for(uint16_t ii = 0; ii < 35*35; ii++) if(frame[ii] != (uint8_t)(ii * 7)) errors++;
+  check(captured && errors == 0, "captured frame matches the model");
+  printf("%36s %lu polls, %lu not ready\n", "", (unsigned long)sensor.stats.framePolls, (unsigned long)sensor.stats.frameNotReady);
+  start(opticalFlow);
+  opticalFlow.exitFrameCaptureMode();
+  report(opticalFlow, "exitFrameCaptureMode");
+
+  start(opticalFlow);
+  opticalFlow.shutdown();
+  report(opticalFlow, "shutdown");
+  check(sensor.isShutdown(), "shutdown() reaches the sensor");
+
+#if PAW3902_PROFILE
+  char line[120];
+  printf("profile, whole run:\n");
+  for(uint8_t op = 0; op < PAW3902_OPS; op++)
+  {
+    paw3902FormatProfile(line, sizeof(line), op, &opticalFlow.getProfile(op), opticalFlow.ticksPerMicro());
+    printf("  %s\n", line);
+  }
+#endif
+
+  printf("\n");
+}
+
+int main()
+{
+  SPI.begin();
+  SPI.attach(&sensor, CSPIN);
+  run(opticalFlow, "Arduino library, SPI stand-in");
+
+  sensor = PAW3902Sim(); // power cycle
+  run(hostFlow, "PAW3902Core<PAW3902HostBus>, direct to the model");
+
+  printf("%s\n", failures ? "FAILED" : "all checks passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+/* FrameFeatures.h corners on synthetic frames: the vector scoring against
+ * the scalar one, a check that drawn corners are found, and frames per
+ * second for each path on one core, on typical scenes and on noise that
+ * makes most pixels corners (the scalar worst case).
+ *
+ * Timing is host time from steady_clock, so the numbers only compare the
+ * paths on this machine; on the MCU the scalar cost is bounded as described
+ * in FrameFeatures.h.
+ *
+ *   g++ -std=c++11 -O2 -Ihost -IPAW3902 host/bench_features.cpp host/FrameFeaturesSimd.cpp
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include "FrameFeaturesSimd.h"
+#include "BenchRandom.h"
+
+#define SCENES    64
+#define THRESHOLD 12 // for the sensor's low-contrast frames
+#define TIMED     0.5 // seconds per timing run
+#define MAX       64
+
+// Soft blobs and a few hard-edged rectangles over noise
+static void scene(uint8_t *frame, int rects)
+{
+  float v[FRAME_PIXELS];
+  for(int ii = 0; ii < FRAME_PIXELS; ii++) v[ii] = 50 + 6 * (uniformf() - 0.5f);
+  for(int b = 0; b < 8; b++)
+  {
+    float bx = uniformf() * 35, by = uniformf() * 35, r = 2 + uniformf() * 4, level = 30 + uniformf() * 80;
+    for(int y = 0; y < FRAME_HEIGHT; y++)
+      for(int x = 0; x < FRAME_WIDTH; x++)
+        v[y * FRAME_WIDTH + x] += level * expf(-((x - bx) * (x - bx) + (y - by) * (y - by)) / (2 * r * r));
+  }
+  for(int r = 0; r < rects; r++)
+  {
+    int x0 = 4 + (int)(uniformf() * 20), y0 = 4 + (int)(uniformf() * 20), w = 5 + (int)(uniformf() * 6), h = 5 + (int)(uniformf() * 6);
+    float level = uniformf() < 0.5f ? -40 : 60;
+    for(int y = y0; y < y0 + h && y < FRAME_HEIGHT; y++)
+      for(int x = x0; x < x0 + w && x < FRAME_WIDTH; x++) v[y * FRAME_WIDTH + x] += level;
+  }
+  for(int ii = 0; ii < FRAME_PIXELS; ii++) frame[ii] = (uint8_t)(v[ii] < 0 ? 0 : v[ii] > 255 ? 255 : v[ii]);
+}
+
+static bool same(const FrameFeature *p, uint16_t n, const FrameFeature *q, uint16_t m)
+{
+  if(n != m) return false;
+  for(uint16_t ii = 0; ii < n; ii++)
+    if(p[ii].x != q[ii].x || p[ii].y != q[ii].y || p[ii].score != q[ii].score) return false;
+  return true;
+}
+
+template <class Fn>
+static double framesPerSecond(Fn detect, const uint8_t (*frames)[FRAME_PIXELS])
+{
+  volatile uint32_t sink = 0;
+  uint32_t calls = 0;
+  double elapsed;
+  auto t0 = std::chrono::steady_clock::now();
+  do
+  {
+    for(int ii = 0; ii < 256; ii++, calls++) sink = sink + detect(frames[ii & 7]);
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  } while(elapsed < TIMED);
+  return calls / elapsed;
+}
+
+int main()
+{
+  static uint8_t frames[SCENES][FRAME_PIXELS], noise[8][FRAME_PIXELS];
+  for(int ii = 0; ii < SCENES; ii++) scene(frames[ii], ii & 3);
+  for(int ii = 0; ii < 8; ii++)
+    for(int jj = 0; jj < FRAME_PIXELS; jj++) noise[ii][jj] = (uint8_t)(uniformf() * 256);
+
+  // Same list from both paths, over thresholds and with the list filling up
+  FrameFeature a[MAX], b[MAX];
+  int mismatches = 0, checked = 0;
+  uint32_t corners = 0;
+  for(int ii = 0; ii < SCENES + 8; ii++)
+  {
+    const uint8_t *frame = ii < SCENES ? frames[ii] : noise[ii - SCENES];
+    for(int t = 0; t <= 60; t += 6)
+      for(uint16_t max = 8; max <= MAX; max *= 8)
+      {
+        uint16_t n = frameFeatures(frame, (uint8_t)t, a, max), m = frameFeaturesSimd(frame, (uint8_t)t, b, max);
+        if(!same(a, n, b, m)) mismatches++;
+        checked++;
+        if(t == THRESHOLD && max == MAX && ii < SCENES) corners += n;
+      }
+  }
+
+  // A lone bright square: its four corners, nothing else
+  uint8_t square[FRAME_PIXELS];
+  for(int ii = 0; ii < FRAME_PIXELS; ii++) square[ii] = 40;
+  for(int y = 12; y < 22; y++)
+    for(int x = 10; x < 24; x++) square[y * FRAME_WIDTH + x] = 120;
+  uint16_t n = frameFeatures(square, THRESHOLD, a, MAX);
+  static const int cx[4] = { 10, 23, 10, 23 }, cy[4] = { 12, 12, 21, 21 };
+  int found = 0;
+  for(int c = 0; c < 4; c++)
+    for(uint16_t ii = 0; ii < n; ii++)
+      if(abs(a[ii].x - cx[c]) <= 1 && abs(a[ii].y - cy[c]) <= 1) { found++; break; }
+
+  printf("kernel %s, threshold %d\n", frameFeaturesKernel(), THRESHOLD);
+  printf("%d of %d detections differ from the scalar path\n", mismatches, checked);
+  printf("square: %u corners, %d of 4 drawn corners found within 1 px\n", n, found);
+  printf("scenes: %.1f corners per frame after suppression\n\n", (double)corners / SCENES);
+
+  double sScene = framesPerSecond([&](const uint8_t *f) { return frameFeatures(f, THRESHOLD, a, MAX); }, frames);
+  double vScene = framesPerSecond([&](const uint8_t *f) { return frameFeaturesSimd(f, THRESHOLD, a, MAX); }, frames);
+  static FrameFeature all[(FEATURE_LAST - FEATURE_FIRST + 1) * (FEATURE_LAST - FEATURE_FIRST + 1)];
+  double sNoise = framesPerSecond([&](const uint8_t *f) { return frameFeatures(f, 0, all, sizeof(all) / sizeof(all[0])); }, noise);
+  double vNoise = framesPerSecond([&](const uint8_t *f) { return frameFeaturesSimd(f, 0, all, sizeof(all) / sizeof(all[0])); }, noise);
+
+  printf("%-22s %15s %15s %8s\n", "frames", "scalar frames/s", "vector frames/s", "speedup");
+  printf("%-22s %15.0f %15.0f %7.1fx\n", "scenes", sScene, vScene, vScene / sScene);
+  printf("%-22s %15.0f %15.0f %7.1fx\n", "noise, threshold 0", sNoise, vNoise, vNoise / sNoise);
+  return mismatches || found != 4 ? 1 : 0;
+}
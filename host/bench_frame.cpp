@@ -0,0 +1,127 @@
+/* captureFrame() throughput and serviceFrame() slice bounds against the host
+ * mock SPI bus.
+ *
+ * FrameDevice answers the 0x58 frame capture handshake with a test pattern
+ * and reports "not yet valid" on roughly one poll in RETRY_ONE_IN, so the
+ * valid-bit retry counters are exercised.
+ *
+ * The frame statistics built during capture (FrameImageStats.h) are checked
+ * against a separate pass over the finished frame. Their cost is CPU work,
+ * which the modeled clock does not charge, so it is timed in host time:
+ * captures with and without them, and the separate pass they replace.
+ */
+
+#include <chrono>
+#include "Arduino.h"
+#include "SPI.h"
+#include "PAW3902.h"
+
+#define CSPIN       10
+#define RETRY_ONE_IN 8
+#define SLICE_US     2000 // serviceFrame() budget per call
+#define TIMED        0.3  // seconds per host timing run
+
+class FrameDevice : public HostSPIDevice {
+public:
+  FrameDevice() : _address(true), _reg(0), _pixel(0), _upper(true), _polls(0) { }
+
+  void select(bool selected) { if(selected) _address = true; }
+
+  uint8_t transfer(uint8_t mosi)
+  {
+    if(_address) { _reg = mosi; _address = false; return 0; }
+    _address = true;
+    if(_reg & 0x80) return 0; // register write
+    if(_reg != 0x58) return 0;
+
+    _polls = _polls * 1103515245u + 12345u;
+    if((_polls >> 16) % RETRY_ONE_IN == 0) return 0x00; // valid bits not set yet
+    uint8_t value = pattern(_pixel);
+    if(_upper) { _upper = false; return 0x40 | (value >> 2); }
+    _upper = true;
+    _pixel = (_pixel + 1) % (35*35);
+    return 0x80 | ((value & 0x03) << 2);
+  }
+
+  static uint8_t pattern(uint16_t pixel) { return (uint8_t)(pixel * 7); }
+
+private:
+  bool _address;
+  uint8_t _reg;
+  uint16_t _pixel;
+  bool _upper;
+  uint32_t _polls;
+};
+
+PAW3902 opticalFlow(CSPIN);
+FrameDevice device;
+uint8_t frameArray[35*35];
+FrameImageStats image, reference;
+
+static bool sameStats(const FrameImageStats & a, const FrameImageStats & b)
+{
+  for(uint8_t ii = 0; ii < FRAME_HISTOGRAM_BINS; ii++) if(a.histogram[ii] != b.histogram[ii]) return false;
+  return a.pixels == b.pixels && a.min == b.min && a.max == b.max && a.mean == b.mean && a.variance == b.variance &&
+         a.sum == b.sum && a.sumSquares == b.sumSquares && a.sharpness == b.sharpness;
+}
+
+// Host nanoseconds per call of fn
+template <class Fn>
+static double hostNsPerCall(Fn fn)
+{
+  uint32_t calls = 0;
+  double elapsed;
+  auto t0 = std::chrono::steady_clock::now();
+  do
+  {
+    for(int ii = 0; ii < 16; ii++, calls++) fn();
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  } while(elapsed < TIMED);
+  return elapsed * 1e9 / calls;
+}
+
+int main()
+{
+  SPI.begin();
+  opticalFlow.begin();
+  SPI.attach(&device, CSPIN);
+  opticalFlow.enterFrameCaptureMode();
+
+  SPI.resetCounters();
+  uint64_t t0 = hostNanos();
+  uint8_t ok = opticalFlow.captureFrame(frameArray);
+  uint64_t us = (hostNanos() - t0) / 1000;
+
+  uint16_t errors = 0;
+  for(uint16_t ii = 0; ii < 35*35; ii++) if(frameArray[ii] != FrameDevice::pattern(ii)) errors++;
+
+  PAW3902FrameStats stats = opticalFlow.getFrameStats();
+  printf("frame %s: %lu us, %u transactions, %u bytes, %u pixel errors\n", ok ? "ok" : "incomplete",
+         (unsigned long)us, SPI.transactions, SPI.bytes, errors);
+  printf("%u pixels, %lu pixels/s, %lu upper / %lu lower retries\n", stats.pixels,
+         (unsigned long)stats.pixelsPerSecond, (unsigned long)stats.upperRetries, (unsigned long)stats.lowerRetries);
+
+  opticalFlow.startFrame(frameArray);
+  uint8_t state;
+  while((state = opticalFlow.serviceFrame(35*35, SLICE_US)) == PAW3902_FRAME_BUSY) hostAdvance(100000); // other work between slices
+
+  stats = opticalFlow.getFrameStats();
+  printf("sliced (%u us budget): state %u, %u slices, max slice %lu us, %lu pixels/s while capturing\n", SLICE_US, state,
+         stats.slices, (unsigned long)stats.maxSliceMicros, (unsigned long)stats.pixelsPerSecond);
+
+  // Statistics built during a sliced capture match a pass over the result
+  opticalFlow.startFrame(frameArray, &image);
+  while(opticalFlow.serviceFrame(35*35, SLICE_US) == PAW3902_FRAME_BUSY) { }
+  frameImageStats(frameArray, 35*35, &reference);
+  bool match = sameStats(image, reference);
+  printf("\nimage stats during capture %s the separate pass: min %u max %u mean %u variance %u sharpness %lu\n",
+         match ? "match" : "DIFFER from", image.min, image.max, image.mean, image.variance, (unsigned long)image.sharpness);
+
+  double off = hostNsPerCall([] { opticalFlow.captureFrame(frameArray); });
+  double on = hostNsPerCall([] { opticalFlow.captureFrame(frameArray, &image); });
+  double pass = hostNsPerCall([] { frameImageStats(frameArray, 35*35, &reference); });
+  printf("host time per frame: capture %.1f us, with stats %.1f us (+%.1f ns/pixel), separate pass %.1f us (%.1f ns/pixel)\n",
+         off / 1000, on / 1000, (on - off) / (35*35), pass / 1000, pass / (35*35));
+  printf("on target a pixel takes %.1f us of SPI\n", 1e6 / stats.pixelsPerSecond);
+  return match && ok ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+/* UART cost of one 35 x 35 frame dump: the sketch's decimal text against
+ * binary raw and row-delta + RLE export (FrameExport.h), for a few synthetic
+ * scenes. Compression depends entirely on the scene, so real captures run
+ * through telemetry_decode are the figure to trust.
+ *
+ * Each scene is also decoded again to check the round trip.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "FrameExport.h"
+#include "BenchRandom.h"
+
+#define BAUD 115200 // 8N1, 10 bits per byte
+
+static std::vector<uint8_t> wire;
+static void capture(const uint8_t *data, uint16_t length) { wire.insert(wire.end(), data, data + length); }
+
+static uint8_t noise(uint8_t amplitude) // 0 .. 2 * amplitude
+{
+  return (uint8_t)((benchRandom() >> 16) % (2 * amplitude + 1));
+}
+
+// What the sketch prints: row number, then every pixel, each followed by a space
+static uint32_t textBytes(const uint8_t *frame)
+{
+  uint32_t bytes = 0;
+  char buf[8];
+  for(int ii = 0; ii < FRAME_HEIGHT; ii++)
+  {
+    bytes += snprintf(buf, sizeof(buf), "%d ", ii);
+    for(int jj = 0; jj < FRAME_WIDTH; jj++) bytes += snprintf(buf, sizeof(buf), "%d ", frame[ii * FRAME_WIDTH + jj]);
+    bytes += 3; // " " and CR LF from println
+  }
+  return bytes;
+}
+
+static uint32_t send(TelemetryEncoder *enc, const uint8_t *frame, uint8_t encoding)
+{
+  FrameHeader header = { 7, 0x0BB8, 1, encoding }, decodedHeader;
+  uint8_t payload[FRAME_MAX_PAYLOAD + 2], decoded[FRAME_PIXELS];
+
+  wire.clear();
+  frameExportSend(enc, frame, &header);
+  uint16_t n = telemetryDecode(wire.data() + 1, wire.size() - 2, payload, sizeof(payload));
+  if(!n || !frameExportDecode(payload, n, &decodedHeader, decoded) || memcmp(decoded, frame, FRAME_PIXELS))
+    printf("  round trip FAILED\n");
+  return wire.size();
+}
+
+int main()
+{
+  TelemetryEncoder enc;
+  telemetryInit(&enc, capture);
+  uint8_t frame[FRAME_PIXELS];
+
+  printf("%-26s %7s %7s %7s   %s\n", "scene", "text", "raw", "rle", "ms at 115200: text / raw / rle");
+  for(int scene = 0; scene < 4; scene++)
+  {
+    const char *name = "";
+    for(int ii = 0; ii < FRAME_HEIGHT; ii++)
+      for(int jj = 0; jj < FRAME_WIDTH; jj++)
+      {
+        uint8_t &p = frame[ii * FRAME_WIDTH + jj];
+        switch(scene)
+        {
+          case 0: name = "flat, noise +-1";        p = 60 + noise(1); break;
+          case 1: name = "vignetted, no noise";    p = 90 - ((ii - 17) * (ii - 17) + (jj - 17) * (jj - 17)) / 12; break;
+          case 2: name = "vertical stripes, +-2";  p = (jj / 5 % 2 ? 110 : 40) + noise(2); break;
+          default: name = "uniform random";        p = noise(127); break;
+        }
+      }
+
+    uint32_t text = textBytes(frame), raw = send(&enc, frame, FRAME_RAW), rle = send(&enc, frame, FRAME_DELTA_RLE);
+    printf("%-26s %7u %7u %7u   %5.0f / %4.0f / %4.0f\n", name, text, raw, rle,
+           text * 10000.0 / BAUD, raw * 10000.0 / BAUD, rle * 10000.0 / BAUD);
+  }
+  return 0;
+}
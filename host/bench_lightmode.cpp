@@ -0,0 +1,111 @@
+/* LightModeController replay and per-sample decision cost.
+ *
+ * With a file argument, replays a recorded trace (one sample per line:
+ * timestamp deltaX deltaY SQUAL RawDataSum Shutter mode) and prints every
+ * decision. Without one, drives a synthetic light ramp from daylight to
+ * near darkness and back through a crude sensor model in which the
+ * reported mode follows the controller's decisions.
+ *
+ * Cost is real host time from steady_clock, since no bus access is involved.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include "LightModeController.h"
+
+#define RAMP_SAMPLES 20000 // one full bright -> dark -> bright sweep
+#define COST_PASSES  500   // sweeps timed for the cost figure
+
+static const char *modeName[] = { "bright", "lowlight", "superlowlight" };
+
+// Sensor model: exposure grows as light falls, each darker mode adds gain
+static void model(uint32_t ii, uint8_t mode, PAW3902Sample *s)
+{
+  static const uint32_t gain[3] = { 1, 2, 8 };
+  uint32_t phase = ii % RAMP_SAMPLES;
+  uint32_t level = phase < RAMP_SAMPLES / 2 ? RAMP_SAMPLES / 2 - phase : phase - RAMP_SAMPLES / 2;
+  uint32_t light = 2 + level * 4000 / (RAMP_SAMPLES / 2); // arbitrary units, 2..4002
+  uint32_t shutter = 4000000UL / (light * gain[mode]);
+  uint32_t raw = light * gain[mode] / 16;
+
+  s->timestamp = ii * 8000;
+  s->deltaX = (int16_t)(ii % 7) - 3;
+  s->deltaY = (int16_t)(ii % 5) - 2;
+  s->Shutter = shutter > 0x1FFF ? 0x1FFF : (uint16_t)shutter;
+  s->RawDataSum = raw > 0xFF ? 0xFF : (uint8_t)raw;
+  s->SQUAL = s->Shutter >= 0x1FF0 ? 20 : 100;
+  s->mode = mode;
+}
+
+static int replay(const char *path)
+{
+  FILE *f = fopen(path, "r");
+  if(!f) { perror(path); return 1; }
+
+  LightModeController ctrl;
+  lightModeInit(&ctrl, NULL);
+  PAW3902Sample s;
+  unsigned long t, squal, raw, shutter, mode, n = 0, invalid = 0;
+  long dx, dy;
+  while(fscanf(f, "%lu %ld %ld %lu %lu %lu %lu", &t, &dx, &dy, &squal, &raw, &shutter, &mode) == 7)
+  {
+    s.timestamp = t; s.deltaX = dx; s.deltaY = dy;
+    s.SQUAL = squal; s.RawDataSum = raw; s.Shutter = shutter; s.mode = mode;
+    if(!lightModeValid(&ctrl, &s)) invalid++;
+    uint8_t next = lightModeUpdate(&ctrl, &s);
+    if(next != LIGHTMODE_HOLD) printf("%10lu us  %s -> %s\n", t, modeName[s.mode], modeName[next]);
+    n++;
+  }
+  fclose(f);
+  printf("%lu samples, %lu gated\n", n, invalid);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc > 1) return replay(argv[1]);
+
+  LightModeController ctrl;
+  lightModeInit(&ctrl, NULL);
+  PAW3902Sample s;
+  uint8_t mode = 0;
+  uint32_t switches = 0;
+
+  for(uint32_t ii = 0; ii < RAMP_SAMPLES; ii++)
+  {
+    model(ii, mode, &s);
+    uint8_t next = lightModeUpdate(&ctrl, &s);
+    if(next != LIGHTMODE_HOLD && next != mode)
+    {
+      printf("sample %6lu  shutter 0x%04X raw 0x%02X  %s -> %s\n", (unsigned long)ii, s.Shutter, s.RawDataSum,
+             modeName[mode], modeName[next]);
+      mode = next;
+      switches++;
+    }
+  }
+  printf("%lu switches over one sweep\n", (unsigned long)switches);
+
+  // Cost: pre-built trace so only the decision is timed
+  static PAW3902Sample trace[RAMP_SAMPLES];
+  mode = 0;
+  lightModeInit(&ctrl, NULL);
+  for(uint32_t ii = 0; ii < RAMP_SAMPLES; ii++)
+  {
+    model(ii, mode, &trace[ii]);
+    uint8_t next = lightModeUpdate(&ctrl, &trace[ii]);
+    if(next != LIGHTMODE_HOLD) mode = next;
+  }
+
+  uint32_t decisions = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for(int pass = 0; pass < COST_PASSES; pass++)
+  {
+    lightModeInit(&ctrl, NULL);
+    for(uint32_t ii = 0; ii < RAMP_SAMPLES; ii++)
+      decisions += (lightModeUpdate(&ctrl, &trace[ii]) != LIGHTMODE_HOLD) + lightModeValid(&ctrl, &trace[ii]);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)COST_PASSES * RAMP_SAMPLES);
+  printf("lightModeUpdate + lightModeValid  %5.2f ns/sample (checksum %lu)\n", ns, (unsigned long)decisions);
+  return 0;
+}
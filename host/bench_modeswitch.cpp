@@ -0,0 +1,52 @@
+/* Full setMode() versus hot switchMode() light mode transitions.
+ *
+ * Reports modeled latency, bus traffic and an estimate of the motion samples
+ * lost per transition. The estimate assumes flow output is blanked for the
+ * whole transition and that the sensor would otherwise report once per
+ * FRAME_PERIOD_US.
+ */
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "PAW3902.h"
+
+#define CSPIN           10
+#define FRAME_PERIOD_US 8000 // nominal navigation frame period assumed for the estimate
+
+PAW3902 opticalFlow(CSPIN);
+
+static const char *modeName[] = { "bright", "lowlight", "superlowlight" };
+
+static void run(const char *path, uint8_t from, uint8_t to, bool hot)
+{
+  opticalFlow.setMode(from);
+
+  SPI.resetCounters();
+  uint64_t t0 = hostNanos();
+  if(hot) opticalFlow.switchMode(to);
+  else    opticalFlow.setMode(to);
+  uint64_t us = (hostNanos() - t0) / 1000;
+
+  char name[32];
+  snprintf(name, sizeof(name), "%s -> %s", modeName[from], modeName[to]);
+  printf("%-28s %-7s %9lu %6u %6u %5lu\n", name, path, (unsigned long)us, SPI.transactions, SPI.bytes,
+         (unsigned long)(us / FRAME_PERIOD_US));
+}
+
+int main()
+{
+  SPI.begin();
+  opticalFlow.begin();
+
+  printf("%-28s %-7s %9s %6s %6s %5s\n", "transition", "path", "us", "txns", "bytes", "lost");
+  for(uint8_t from = bright; from <= superlowlight; from++)
+  {
+    for(uint8_t to = bright; to <= superlowlight; to++)
+    {
+      if(from == to) continue;
+      run("setMode", from, to, false);
+      run("switch", from, to, true);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,141 @@
+/* Several PAW3902s on one SPI port, read through SensorScheduler.
+ *
+ * Three modeled sensors share the SPI stand-in, each on its own chip select
+ * and raising its motion interrupt at its own rate. The loop reads whichever
+ * sensor the scheduler picks, the way MAX32660/Main.c does with
+ * ISR_ACQUISITION 0, and the run is made once per policy. Per sensor it
+ * reports reads per second, the worst interrupt-to-read age and interrupts
+ * coalesced, plus the bus load.
+ *
+ * All three sensors see the same motion, a sine. After every read the
+ * sensors are aligned to the oldest of their latest reads, and their summed
+ * displacement there is compared with the true one: once interpolated with
+ * sensorSchedPositionAt(), once taking each sensor's latest sample as is.
+ */
+
+#include <math.h>
+#include "Arduino.h"
+#include "SPI.h"
+#include "PAW3902.h"
+#include "PAW3902Sim.h"
+#include "SensorScheduler.h"
+
+#define SENSORS 3
+#define RUN_US  2000000
+
+static const uint8_t csPins[SENSORS] = { 10, 9, 8 };
+static const uint32_t periodUs[SENSORS] = { 200, 250, 333 }; // motion interrupt intervals
+static const uint32_t phaseUs[SENSORS] = { 0, 70, 150 };
+static const uint8_t priority[SENSORS] = { 0, 0, 1 };       // sensor 2 first under SENSOR_SCHED_PRIORITY
+
+PAW3902Sim sensors[SENSORS];
+PAW3902 flows[SENSORS] = { PAW3902(csPins[0]), PAW3902(csPins[1]), PAW3902(csPins[2]) };
+
+// True displacement in counts at t us
+static double truth(uint32_t t) { return 400.0 * sin(2.0 * M_PI * t / 100000.0); }
+
+static void run(uint8_t policy, const char *name)
+{
+  SensorScheduler sched;
+  SensorStats stats[SENSORS], total;
+  int32_t injected[SENSORS] = { 0 };
+  uint32_t nextEdge[SENSORS];
+  double interpError = 0, heldError = 0, interpMax = 0, heldMax = 0;
+  uint32_t aligned = 0;
+  uint64_t busy = 0;
+
+  uint32_t start = micros();
+  sensorSchedInit(&sched, SENSORS, policy, start);
+  for(uint8_t ii = 0; ii < SENSORS; ii++)
+  {
+    sched.sensors[ii].priority = priority[ii];
+    nextEdge[ii] = start + phaseUs[ii];
+  }
+
+  PAW3902Sample sample;
+  while(micros() - start < RUN_US)
+  {
+    // Motion interrupts stamp their edge, whenever the loop gets to them
+    for(uint8_t ii = 0; ii < SENSORS; ii++)
+      while((int32_t)(micros() - nextEdge[ii]) >= 0)
+      {
+        sensorSchedRaise(&sched, ii, nextEdge[ii]);
+        nextEdge[ii] += periodUs[ii];
+      }
+
+    uint8_t sensor = sensorSchedNext(&sched);
+    if(sensor == SENSOR_SCHED_NONE)
+    {
+      uint32_t wait = 0xFFFFFFFF;
+      for(uint8_t ii = 0; ii < SENSORS; ii++)
+        if(nextEdge[ii] - micros() < wait) wait = nextEdge[ii] - micros();
+      delayMicroseconds(wait);
+      continue;
+    }
+
+    // The sensor has counted everything up to now
+    int32_t position = (int32_t)lround(truth(micros() - start));
+    sensors[sensor].addMotion((int16_t)(position - injected[sensor]), 0);
+    injected[sensor] = position;
+
+    uint64_t t0 = hostNanos();
+    flows[sensor].readSample(&sample);
+    busy += hostNanos() - t0;
+    sensorSchedDone(&sched, sensor, &sample);
+
+    // Align every sensor to the oldest latest read
+    uint32_t at = sched.sensors[0].t[1];
+    bool ready = true;
+    for(uint8_t ii = 0; ii < SENSORS; ii++)
+    {
+      if(sched.sensors[ii].reads < 2) ready = false;
+      if((int32_t)(sched.sensors[ii].t[1] - at) < 0) at = sched.sensors[ii].t[1];
+    }
+    if(!ready) continue;
+    double expected = truth(at - start);
+    for(uint8_t ii = 0; ii < SENSORS; ii++)
+    {
+      int32_t x = 0, y = 0;
+      sensorSchedPositionAt(&sched, ii, at, &x, &y);
+      double interp = fabs(x - expected), held = fabs(sched.sensors[ii].x[1] - expected);
+      interpError += interp;
+      heldError += held;
+      if(interp > interpMax) interpMax = interp;
+      if(held > heldMax) heldMax = held;
+      aligned++;
+    }
+  }
+
+  sensorSchedTake(&sched, micros(), stats, &total);
+  printf("%s\n%-8s %10s %10s %10s %10s\n", name, "sensor", "rate_hz", "reads/s", "max_age_us", "coalesced");
+  for(uint8_t ii = 0; ii < SENSORS; ii++)
+    printf("%-8u %10lu %10lu %10lu %10lu\n", ii, 1000000UL / periodUs[ii], (unsigned long)stats[ii].samplesPerSecond,
+           (unsigned long)stats[ii].maxAgeMicros, (unsigned long)stats[ii].coalesced);
+  printf("%-8s %10s %10lu %10lu %10lu\n", "all", "", (unsigned long)total.samplesPerSecond,
+         (unsigned long)total.maxAgeMicros, (unsigned long)total.coalesced);
+  printf("bus busy %.1f%%; alignment error, counts: interpolated mean %.2f max %.2f, latest sample mean %.2f max %.2f\n\n",
+         busy / 10.0 / RUN_US, interpError / aligned, interpMax, heldError / aligned, heldMax);
+}
+
+int main()
+{
+  SPI.begin();
+  for(uint8_t ii = 0; ii < SENSORS; ii++)
+  {
+    SPI.attach(&sensors[ii], csPins[ii]);
+    if(!flows[ii].begin() || !flows[ii].PAW3902Core<PAW3902ArduinoBus>::checkID())
+    {
+      printf("sensor %u did not answer\n", ii);
+      return 1;
+    }
+  }
+
+  run(SENSOR_SCHED_ROUND_ROBIN, "round robin");
+  run(SENSOR_SCHED_PRIORITY, "priority, sensor 2 first");
+
+  uint32_t violations = 0;
+  for(uint8_t ii = 0; ii < SENSORS; ii++)
+    violations += sensors[ii].stats.tSRADViolations + sensors[ii].stats.tSRRViolations + sensors[ii].stats.tSWWViolations;
+  printf("%lu SPI timing violations\n", (unsigned long)violations);
+  return violations ? 1 : 0;
+}
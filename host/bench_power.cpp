@@ -0,0 +1,184 @@
+/* PowerManager duty cycling against the register-level sensor model.
+ *
+ * Ten minutes of modeled time alternate still spells of 0.3 to 30 s with
+ * moves of 0.2 to 10 s. While moving the sensor raises its motion interrupt
+ * every 8 ms, as in bright light, and the loop reads the burst whenever the
+ * sensor is up; the loop polls the PowerManager every 10 ms and shuts the
+ * sensor down or wakes it with PAW3902Core's shutdown() and wake(). Each
+ * configuration reports the share of time the sensor was powered, the wakes,
+ * wake() and wake-to-first-sample latency, and samples lost: the manager's
+ * estimate next to the true count of motion interrupts the sensor missed
+ * while down or waking.
+ *
+ * The last configuration wakes only on powerTrigger(), called at the start of
+ * each move as another motion sensor (an accelerometer, say) would.
+ *
+ * The model answers as soon as it is reset and loaded, so wake latency here is
+ * the driver's own: the reset delay, the table's settle delays and the bus.
+ *
+ *   g++ -std=c++11 -O2 -Ihost -IPAW3902 host/bench_power.cpp host/PAW3902Sim.cpp host/HostArduino.cpp -o bench_power
+ */
+
+#include <stdio.h>
+#include <vector>
+#include "Arduino.h"
+#include "PAW3902Sim.h"
+#include "PAW3902HostBus.h"
+#include "PowerManager.h"
+#include "BenchRandom.h"
+
+#define RUN_US   600000000UL // ten minutes
+#define FRAME_US 8000        // motion interrupt interval while moving
+#define POLL_US  10000       // loop pass
+
+struct Move { uint32_t start, end; }; // us from the start of the run
+
+static uint32_t between(uint32_t lo, uint32_t hi) // lo .. hi, skewed low
+{
+  uint32_t r = (benchRandom() >> 8) & 0xFFFF;
+  return lo + (uint32_t)((uint64_t)(hi - lo) * r / 65536 * r / 65536);
+}
+
+static std::vector<Move> script()
+{
+  std::vector<Move> moves;
+  for(uint32_t t = between(300000, 30000000); t < RUN_US; )
+  {
+    Move m = { t, t + between(200000, 10000000) };
+    moves.push_back(m);
+    t = m.end + between(300000, 30000000);
+  }
+  return moves;
+}
+
+struct Result {
+  PowerStats stats;
+  uint32_t samples, missed;
+};
+
+static Result run(const std::vector<Move> &moves, const PowerConfig *config, bool trigger)
+{
+  PAW3902Sim sensor;
+  PAW3902Core<PAW3902HostBus> flow((PAW3902HostBus(&sensor)));
+  flow.begin();
+  flow.setMode(bright);
+
+  uint32_t start = micros();
+  PowerManager pm;
+  powerInit(&pm, config, start);
+
+  Result r = {};
+  uint32_t nextFrame = start + FRAME_US, nextPoll = start + POLL_US, readyAt = start;
+  size_t move = 0;
+  bool down = false, triggered = false;
+  while(micros() - start < RUN_US)
+  {
+    uint32_t now = micros();
+    if((int32_t)(nextFrame - now) > 0 && (int32_t)(nextPoll - now) > 0)
+    {
+      uint32_t next = (int32_t)(nextFrame - nextPoll) < 0 ? nextFrame : nextPoll;
+      delayMicroseconds(next - now);
+      continue;
+    }
+
+    uint32_t t = now - start;
+    while(move < moves.size() && moves[move].end <= t) { move++; triggered = false; }
+    bool moving = move < moves.size() && moves[move].start <= t;
+
+    if(trigger && moving && !triggered)
+    {
+      powerTrigger(&pm, start + moves[move].start);
+      triggered = true;
+    }
+
+    // Motion interrupts while the sensor is down or waking are never seen
+    while((int32_t)(now - nextFrame) >= 0)
+    {
+      if(moving)
+      {
+        if(down || (int32_t)(nextFrame - readyAt) < 0) r.missed++;
+        else
+        {
+          PAW3902Sample sample;
+          sensor.addMotion(4, 1);
+          flow.readSample(&sample);
+          powerSample(&pm, &sample);
+          r.samples++;
+        }
+      }
+      nextFrame += FRAME_US;
+    }
+
+    if((int32_t)(now - nextPoll) >= 0)
+    {
+      switch(powerPoll(&pm, now))
+      {
+        case POWER_SHUTDOWN:
+          flow.shutdown();
+          down = true;
+          break;
+        case POWER_WAKE:
+          flow.wake();
+          readyAt = micros();
+          powerAwake(&pm, readyAt);
+          down = false;
+          break;
+      }
+      nextPoll += POLL_US;
+    }
+  }
+  powerTake(&pm, micros(), &r.stats);
+  return r;
+}
+
+int main()
+{
+  std::vector<Move> moves = script();
+  uint64_t movingUs = 0;
+  for(size_t ii = 0; ii < moves.size(); ii++) movingUs += moves[ii].end - moves[ii].start;
+  printf("%zu moves, moving %.1f%% of %lu s\n\n", moves.size(), 100.0 * movingUs / RUN_US, RUN_US / 1000000);
+
+  // Cost of coming back: wake() against begin() and setMode()
+  PAW3902Sim sensor;
+  PAW3902Core<PAW3902HostBus> flow((PAW3902HostBus(&sensor)));
+  flow.begin();
+  flow.setMode(bright);
+  flow.shutdown();
+  uint64_t t0 = hostNanos();
+  flow.wake();
+  uint64_t wakeNanos = hostNanos() - t0;
+  bool woke = !sensor.isShutdown() && sensor.reg(0, 0x00) == 0x49;
+  static uint8_t woken[PAW3902SIM_BANKS][128];
+  for(uint8_t bank = 0; bank < PAW3902SIM_BANKS; bank++) memcpy(woken[bank], sensor.registerFile(bank), 128);
+  memset(&woken[0][0x02], 0, 0x0C - 0x02 + 1); // motion data wake() latched; setMode() resets after begin() latches them
+  flow.shutdown();
+  t0 = hostNanos();
+  flow.begin();
+  flow.setMode(bright);
+  uint64_t beginNanos = hostNanos() - t0;
+  bool same = true;
+  for(uint8_t bank = 0; bank < PAW3902SIM_BANKS; bank++) same = same && !memcmp(woken[bank], sensor.registerFile(bank), 128);
+  printf("wake() %.2f ms, begin() + setMode() %.2f ms; %s, %s\n\n", wakeNanos / 1e6, beginNanos / 1e6,
+         woke ? "sensor answers after wake()" : "SENSOR DOWN AFTER wake()", same ? "same registers" : "REGISTERS DIFFER");
+
+  struct { const char *name; PowerConfig config; bool trigger; } runs[] = {
+    { "always on",              { 0, 0, 0, 2 },                   false },
+    { "idle 2 s, look 200 ms",  { 2000000, 200000, 40000, 2 },    false },
+    { "idle 2 s, look 500 ms",  powerDefaults,                    false },
+    { "idle 2 s, look 2 s",     { 2000000, 2000000, 40000, 2 },   false },
+    { "idle 500 ms, look 500",  { 500000, 500000, 40000, 2 },     false },
+    { "idle 2 s, trigger only", { 2000000, 0, 40000, 2 },         true },
+  };
+
+  printf("%-24s %7s %6s %9s %16s %9s %9s\n", "", "awake", "wakes", "wake() us", "first sample us", "lost est", "lost");
+  for(size_t ii = 0; ii < sizeof(runs) / sizeof(runs[0]); ii++)
+  {
+    Result r = run(moves, &runs[ii].config, runs[ii].trigger);
+    char latency[32];
+    snprintf(latency, sizeof(latency), "%lu/%lu", (unsigned long)r.stats.meanDataMicros, (unsigned long)r.stats.maxDataMicros);
+    printf("%-24s %6.1f%% %6u %9lu %16s %9lu %9lu\n", runs[ii].name, r.stats.awakePermille / 10.0, r.stats.wakes,
+           (unsigned long)r.stats.maxWakeMicros, latency, (unsigned long)r.stats.samplesLost, (unsigned long)r.missed);
+  }
+  printf("(first sample: mean/max from the wake request; lost: motion interrupts missed while down or waking)\n");
+  return woke && same ? 0 : 1;
+}
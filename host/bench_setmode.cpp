@@ -0,0 +1,45 @@
+/* setMode() wall time against the host mock SPI bus.
+ *
+ * Walks the sensor through every light mode transition and reports modeled
+ * wall time, the part of it spent in deliberate delays, and the bus
+ * transactions and bytes each setMode() issued.
+ */
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "PAW3902.h"
+
+#define CSPIN 10
+
+PAW3902 opticalFlow(CSPIN);
+
+static const char *modeName[] = { "bright", "lowlight", "superlowlight" };
+
+int main()
+{
+  static const uint8_t path[] = { bright, lowlight, superlowlight, lowlight, bright, superlowlight, bright };
+
+  SPI.begin();
+  opticalFlow.begin();
+
+  printf("%-28s %9s %9s %9s %6s %6s\n", "transition", "wall_us", "bus_us", "wait_us", "txns", "bytes");
+  for(uint8_t ii = 1; ii < sizeof(path); ii++)
+  {
+    opticalFlow.setMode(path[ii - 1]);
+
+    SPI.resetCounters();
+    uint64_t t0 = hostNanos(), w0 = hostDelayNanos();
+    opticalFlow.setMode(path[ii]);
+    uint64_t wall = hostNanos() - t0, wait = hostDelayNanos() - w0;
+
+    char name[32];
+    snprintf(name, sizeof(name), "%s -> %s", modeName[path[ii - 1]], modeName[path[ii]]);
+    printf("%-28s %9.1f %9.1f %9.1f %6u %6u\n", name, wall / 1000.0, (wall - wait) / 1000.0, wait / 1000.0,
+           SPI.transactions, SPI.bytes);
+  }
+
+  PAW3902SequenceStats stats = opticalFlow.getSequenceStats();
+  printf("last sequence: %u writes, %u transactions, %lu us waiting\n",
+         stats.writes, stats.transactions, (unsigned long)stats.waitMicros);
+  return 0;
+}
@@ -0,0 +1,128 @@
+/* Linux spidev transport (Linux/PAW3902Spidev.h) against the sensor model
+ * through a fake spidev node (FakeSpidev).
+ *
+ * Each row is one driver call with its modeled wall time, ioctls, the
+ * spi_ioc_transfer segments they carried, bytes clocked, the syscalls a
+ * transport making one ioctl per register access would need (the model's
+ * register access count), and any SPI timing breaches the model saw. The
+ * syscall cost is the assumed FAKE_SPIDEV_SYSCALL_NS.
+ *
+ * The driver's results are checked as in bench_driver; exits non-zero if any
+ * check fails.
+ */
+
+#include "Arduino.h"
+#include "PAW3902Sim.h"
+#include "FakeSpidev.h"
+#include "PAW3902Spidev.h"
+
+PAW3902Sim sensor;
+FakeSpidev node(&sensor);
+PAW3902Core<PAW3902SpidevBus<FakeSpidevSys> > opticalFlow((PAW3902SpidevBus<FakeSpidevSys>(3)));
+static int failures = 0;
+
+static uint64_t t0;
+
+static void start()
+{
+  node.resetCounters();
+  sensor.resetStats();
+  t0 = hostNanos();
+}
+
+static void report(const char *name)
+{
+  const PAW3902SimStats &s = sensor.stats;
+  uint32_t violations = s.tSRADViolations + s.tSRRViolations + s.tSWWViolations;
+  printf("%-36s %10.1f %8u %8u %6u %8u %5lu\n", name, (hostNanos() - t0) / 1000.0, node.syscalls, node.segments,
+         node.bytes, s.writes + s.reads + s.bursts, (unsigned long)violations);
+}
+
+static void check(bool ok, const char *what)
+{
+  if(ok) return;
+  printf("FAIL: %s\n", what);
+  failures++;
+}
+
+int main()
+{
+  fakeSpidev = &node;
+
+  printf("%-36s %10s %8s %8s %6s %8s %5s\n", "operation", "wall_us", "ioctls", "segments", "bytes", "naive", "viol");
+
+  start();
+  opticalFlow.begin();
+  report("begin");
+
+  start();
+  check(opticalFlow.checkID(), "checkID() sees 0x49 / 0xB6");
+  report("checkID");
+
+  start();
+  opticalFlow.setMode(bright);
+  report("setMode(bright)");
+  start();
+  opticalFlow.setMode(superlowlight);
+  report("setMode(superlowlight)");
+  start();
+  opticalFlow.switchMode(lowlight);
+  report("switchMode(superlowlight -> lowlight)");
+  check(opticalFlow.getSequenceStats().transactions == 1, "a register table goes out as one transaction");
+
+  sensor.setImageQuality(87, 0x5A, 0x0BB8);
+  sensor.addMotion(-12, 345);
+  PAW3902Sample sample;
+  start();
+  opticalFlow.readSample(&sample);
+  report("readSample");
+  check(sample.deltaX == -12 && sample.deltaY == 345 && sample.SQUAL == 87 && sample.Shutter == 0x0BB8,
+        "burst decodes the injected motion");
+
+  sensor.addMotion(7, -3);
+  int16_t dx, dy;
+  uint8_t SQUAL;
+  uint16_t shutter;
+  start();
+  uint8_t motion = opticalFlow.status();
+  opticalFlow.readMotionCount(&dx, &dy, &SQUAL, &shutter);
+  report("status + readMotionCount");
+  check((motion & 0x80) && dx == 7 && dy == -3 && SQUAL == 87 && shutter == 0x0BB8, "motion registers match the injected motion");
+
+  uint8_t frame[35*35];
+  sensor.setFrameNotReady(8);
+  start();
+  opticalFlow.enterFrameCaptureMode();
+  report("enterFrameCaptureMode");
+  for(uint8_t pass = 0; pass < 2; pass++)
+  {
+    start();
+    uint8_t captured = opticalFlow.captureFrame(frame);
+    report(pass ? "captureFrame (again)" : "captureFrame");
+    uint16_t errors = 0;
+    for(uint16_t ii = 0; ii < 35*35; ii++) if(frame[ii] != (uint8_t)(ii * 7)) errors++;
+    check(captured && errors == 0, "captured frame matches the model");
+  }
+
+  // Sliced capture: read-ahead polls carry over between slices
+  start();
+  opticalFlow.startFrame(frame);
+  while(opticalFlow.serviceFrame(35*35, 2000) == PAW3902_FRAME_BUSY) { }
+  report("startFrame + serviceFrame(2 ms)");
+  uint16_t errors = 0;
+  for(uint16_t ii = 0; ii < 35*35; ii++) if(frame[ii] != (uint8_t)(ii * 7)) errors++;
+  check(opticalFlow.getFrameStats().slices > 1 && errors == 0, "sliced frame matches the model");
+
+  start();
+  opticalFlow.exitFrameCaptureMode();
+  report("exitFrameCaptureMode");
+
+  start();
+  opticalFlow.shutdown();
+  report("shutdown");
+  check(sensor.isShutdown(), "shutdown() reaches the sensor");
+  check(opticalFlow.bus().errors == 0, "no ioctl failed");
+
+  printf("%s\n", failures ? "FAILED" : "all checks passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,328 @@
+/* The sketch's cooperative task schedule against the loop it replaced, which
+ * ended every pass with delay(100).
+ *
+ * Sixty seconds of modeled time with the sensor raising its motion interrupt
+ * every 8 ms, as in bright light. The interrupt reads the burst at once, as
+ * with ISR_ACQUISITION: one that falls due inside a delay, a mode switch's
+ * settle waits included, runs at its time (hostWaitHook()); one that falls in
+ * other work is read when the task returns but keeps its interrupt time. Both
+ * loops do what PAW3902.ino does with the samples: rate them, run the light
+ * mode hysteresis, switch mode (forced every 3 s here, the model's image
+ * never asks) with reads held off, send every sample, and grab five frames
+ * every 15 s. Serial output blocks for its bytes, at 115200 baud or at about
+ * 1 MB/s for the Dragonfly's USB serial.
+ *
+ * Each row reports samples sent per second, interrupt-to-output latency,
+ * samples dropped by either ring and bursts read mid-switch, outside bank 0;
+ * for the schedule, each task's deadline misses and worst response, with the
+ * sketch's periods and deadlines. The last row switches without holding
+ * reads off, to show what that costs.
+ *
+ *   g++ -std=c++11 -O2 -Ihost -IPAW3902 host/bench_tasks.cpp host/PAW3902Sim.cpp host/HostArduino.cpp -o bench_tasks
+ */
+
+#include <stdio.h>
+#include "Arduino.h"
+#include "PAW3902Sim.h"
+#include "PAW3902HostBus.h"
+#include "MotionRing.h"
+#include "LightModeController.h"
+#include "TaskScheduler.h"
+
+#define RUN_US      60000000UL
+#define FRAME_US    8000     // motion interrupt interval
+#define SWITCH_US   3000000  // forced light mode switch
+#define CAPTURE_US  15000000 // five frames this often
+#define SLICE_US    5000     // FRAME_SLICE_US
+#define TEXT_BYTES  92       // one sample as the sketch prints it
+#define TOTAL_BYTES 48       // the old loop's "Total" line
+#define REPORT_BYTES (40 + 5 * 70) // report task: totals, busy and one line per task
+#define BINARY_BYTES 19      // telemetrySendMotion() on the wire
+
+// Sketch periods
+#define MOTION_TASK_US     2000
+#define MOTION_DEADLINE_US 40000
+#define MODE_TASK_US       100000
+#define OUTPUT_TASK_US     10000
+#define OUTPUT_DEADLINE_US 50000
+#define FRAME_TASK_US      10000
+#define FRAME_DEADLINE_US  50000
+#define REPORT_TASK_US     1000000
+
+static PAW3902Sim sensor;
+static PAW3902Core<PAW3902HostBus> flow((PAW3902HostBus(&sensor)));
+
+static struct {
+  uint32_t nanosPerByte, sampleBytes;
+  MotionRing motionRing, outputRing;
+  LightModeController lightMode;
+  uint8_t pendingMode, frameArray[35 * 35], frames;
+  bool acquire, missed, capturing;
+  bool unmasked; // switch modes with reads left on
+  uint32_t nextIrq, nextSwitch, nextCapture, start;
+  uint32_t sent;
+  uint64_t latencySum;
+  uint32_t maxLatency;
+  TaskScheduler tasks;
+  TaskStats total[TASK_MAX];
+} app;
+
+static void serialWrite(uint32_t bytes) { hostAdvance((uint64_t)bytes * app.nanosPerByte); }
+
+static void readMotion(uint32_t at)
+{
+  PAW3902Sample s;
+  flow.readSample(&s);
+  s.timestamp = at;
+  motionRingPush(&app.motionRing, &s);
+}
+
+// The sketch's myIntHandler()
+static void motionInterrupt(uint32_t at)
+{
+  sensor.addMotion(3, 1);
+  if(app.acquire) readMotion(at);
+  else app.missed = true;
+}
+
+// Motion interrupts that fell due while a task ran, read as if the handler had run on time
+static void motionInterrupts()
+{
+  noInterrupts();
+  while((int32_t)(micros() - app.nextIrq) >= 0)
+  {
+    motionInterrupt(app.nextIrq);
+    app.nextIrq += FRAME_US;
+  }
+  interrupts();
+}
+
+// ... and those that fall due inside a delay, at their time
+static void motionDuringWait(uint64_t endNanos)
+{
+  uint32_t end = (uint32_t)(endNanos / 1000);
+  while((int32_t)(end - app.nextIrq) >= 0)
+  {
+    int32_t early = app.nextIrq - micros();
+    if(early > 0) hostAdvance(1000ULL * early);
+    motionInterrupt(app.nextIrq);
+    app.nextIrq += FRAME_US;
+  }
+}
+
+// The sketch's resumeAcquisition(): missed bursts are read before the handler may read again
+static void resumeAcquisition()
+{
+  while(app.missed)
+  {
+    app.missed = false;
+    readMotion(micros());
+  }
+  app.acquire = true;
+}
+
+static void rate(PAW3902Sample * s)
+{
+  lightModeRate(&app.lightMode, s);
+  uint8_t newMode = lightModeUpdate(&app.lightMode, s);
+  if(newMode != LIGHTMODE_HOLD) app.pendingMode = newMode;
+  if((int32_t)(s->timestamp - app.nextSwitch) >= 0)
+  {
+    app.pendingMode = flow.getMode() == bright ? lowlight : bright;
+    app.nextSwitch += SWITCH_US;
+  }
+}
+
+static void send(const PAW3902Sample * s)
+{
+  serialWrite(app.sampleBytes);
+  uint32_t latency = micros() - s->timestamp;
+  app.latencySum += latency;
+  if(latency > app.maxLatency) app.maxLatency = latency;
+  app.sent++;
+}
+
+static void switchMode()
+{
+  if(app.pendingMode == LIGHTMODE_HOLD || !app.acquire) return;
+  if(!app.unmasked) app.acquire = false;
+  flow.switchMode(app.pendingMode);
+  app.pendingMode = LIGHTMODE_HOLD;
+  resumeAcquisition();
+}
+
+// One step of the sketch's frame capture: start a grab when due, or service it
+static void frameStep()
+{
+  if(!app.capturing)
+  {
+    if((int32_t)(micros() - app.nextCapture) < 0) return;
+    app.nextCapture += CAPTURE_US;
+    app.acquire = false;
+    flow.enterFrameCaptureMode();
+    flow.startFrame(app.frameArray);
+    app.frames = 0;
+    app.capturing = true;
+    return;
+  }
+  if(flow.serviceFrame(35 * 35, SLICE_US) == PAW3902_FRAME_BUSY) return;
+  if(app.nanosPerByte && app.sampleBytes != BINARY_BYTES) serialWrite(35 * 35 * 4); // printed as decimal text
+  else serialWrite(35 * 35 + 12);
+  if(++app.frames < 5)
+  {
+    flow.startFrame(app.frameArray);
+    return;
+  }
+  flow.exitFrameCaptureMode();
+  delay(10); // reset pulse
+  flow.initRegisters(flow.getMode());
+  resumeAcquisition();
+  app.capturing = false;
+}
+
+// The loop before: everything in one pass, then delay(100) unless capturing
+static void oldLoop()
+{
+  PAW3902Sample s;
+  while(motionRingPop(&app.motionRing, &s))
+  {
+    rate(&s);
+    switchMode();
+    send(&s);
+  }
+  if(app.sampleBytes != BINARY_BYTES) serialWrite(TOTAL_BYTES);
+  frameStep();
+  if(!app.capturing) delay(100);
+}
+
+// The sketch's tasks
+static void motionTask()
+{
+  PAW3902Sample s;
+  while(motionRingPop(&app.motionRing, &s))
+  {
+    rate(&s);
+    motionRingPush(&app.outputRing, &s);
+  }
+}
+
+static void modeTask() { switchMode(); }
+
+static void outputTask()
+{
+  PAW3902Sample s;
+  while(motionRingPop(&app.outputRing, &s)) send(&s);
+}
+
+static void frameTask() { frameStep(); }
+
+static void reportTask()
+{
+  TaskStats stats[TASK_MAX];
+  taskTake(&app.tasks, micros(), stats);
+  for(uint8_t ii = 0; ii < app.tasks.count; ii++)
+  {
+    TaskStats * t = &app.total[ii];
+    t->runs += stats[ii].runs;
+    t->misses += stats[ii].misses;
+    t->skipped += stats[ii].skipped;
+    if(stats[ii].maxRunMicros > t->maxRunMicros) t->maxRunMicros = stats[ii].maxRunMicros;
+    if(stats[ii].maxResponseMicros > t->maxResponseMicros) t->maxResponseMicros = stats[ii].maxResponseMicros;
+  }
+  if(app.sampleBytes != BINARY_BYTES) serialWrite(REPORT_BYTES);
+}
+
+static void run(bool scheduled, uint32_t nanosPerByte, uint32_t sampleBytes, bool unmasked)
+{
+  hostWaitHook(NULL);
+  flow.begin();
+  flow.setMode(bright);
+  sensor.resetStats();
+  memset(&app, 0, sizeof(app));
+  app.nanosPerByte = nanosPerByte;
+  app.sampleBytes = sampleBytes;
+  app.unmasked = unmasked;
+  lightModeInit(&app.lightMode, NULL);
+  app.pendingMode = LIGHTMODE_HOLD;
+  app.acquire = true;
+  app.start = micros();
+  app.nextIrq = app.start + FRAME_US;
+  app.nextSwitch = app.start + SWITCH_US;
+  app.nextCapture = app.start + CAPTURE_US;
+
+  taskInit(&app.tasks, app.start);
+  taskAdd(&app.tasks, "motion", motionTask, MOTION_TASK_US, MOTION_DEADLINE_US, app.start);
+  taskAdd(&app.tasks, "mode",   modeTask,   MODE_TASK_US,   0, app.start);
+  taskAdd(&app.tasks, "output", outputTask, OUTPUT_TASK_US, OUTPUT_DEADLINE_US, app.start);
+  taskAdd(&app.tasks, "frame",  frameTask,  FRAME_TASK_US,  FRAME_DEADLINE_US, app.start);
+  taskAdd(&app.tasks, "report", reportTask, REPORT_TASK_US, 0, app.start);
+  hostWaitHook(motionDuringWait);
+
+  while(micros() - app.start < RUN_US)
+  {
+    motionInterrupts();
+    if(!scheduled)
+    {
+      oldLoop();
+      continue;
+    }
+    uint32_t now = micros();
+    uint8_t task = taskNext(&app.tasks, now);
+    if(task == TASK_NONE)
+    {
+      uint32_t idle = taskIdleMicros(&app.tasks, now), irq = app.nextIrq - now;
+      delayMicroseconds(idle < irq ? idle : irq);
+      continue;
+    }
+    app.tasks.tasks[task].run();
+    taskDone(&app.tasks, task, now, micros());
+  }
+  hostWaitHook(NULL);
+  if(scheduled) reportTask(); // fold in the last partial window
+}
+
+// One row of the table; false if the run lost samples or read bursts mid-switch
+static bool row(const char * name, bool scheduled, uint32_t nanosPerByte, uint32_t sampleBytes, bool unmasked)
+{
+  run(scheduled, nanosPerByte, sampleBytes, unmasked);
+  char latency[32];
+  snprintf(latency, sizeof(latency), "%.1f/%.1f ms", app.sent ? app.latencySum / 1e3 / app.sent : 0.0, app.maxLatency / 1e3);
+  printf("%-16s %-12s %10.1f %18s %9lu %9lu\n", name, unmasked ? "tasks, bare" : scheduled ? "tasks" : "delay(100)",
+         app.sent / (RUN_US / 1e6), latency, (unsigned long)(app.motionRing.overruns + app.outputRing.overruns),
+         (unsigned long)sensor.stats.bankedBursts);
+  if(scheduled)
+  {
+    printf("%30s", "");
+    for(uint8_t jj = 0; jj < app.tasks.count; jj++)
+    {
+      printf(" %s %lu/%lu", app.tasks.tasks[jj].name, (unsigned long)app.total[jj].misses, (unsigned long)app.total[jj].maxResponseMicros);
+    }
+    printf("\n");
+  }
+  if(sensor.stats.bankedBursts) return false;
+  return !scheduled || sampleBytes != BINARY_BYTES || !(app.motionRing.overruns + app.outputRing.overruns);
+}
+
+int main()
+{
+  struct { const char *name; uint32_t nanosPerByte, sampleBytes; } outputs[] = {
+    { "binary, 115200", 86806, BINARY_BYTES },
+    { "text, 115200",   86806, TEXT_BYTES },
+    { "text, USB",      1000,  TEXT_BYTES },
+  };
+
+  printf("%lu s, motion interrupt every %u us (%u samples/s), frames grabbed every %u s\n\n", RUN_US / 1000000, FRAME_US,
+         1000000 / FRAME_US, CAPTURE_US / 1000000);
+  printf("%-16s %-12s %10s %18s %9s %9s\n", "output", "loop", "samples/s", "latency mean/max", "dropped", "mid-switch");
+  bool fine = true;
+  for(size_t ii = 0; ii < sizeof(outputs) / sizeof(outputs[0]); ii++)
+  {
+    for(int scheduled = 0; scheduled <= 1; scheduled++)
+    {
+      if(!row(outputs[ii].name, scheduled, outputs[ii].nanosPerByte, outputs[ii].sampleBytes, false)) fine = false;
+    }
+  }
+  if(row(outputs[0].name, true, outputs[0].nanosPerByte, outputs[0].sampleBytes, true)) fine = false; // has to catch the bare switch
+  printf("(tasks: deadline misses / worst response in us per task; bare: modes switched with reads left on)\n");
+  return fine ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+/* VelocityEstimator.h on a synthetic flight: accuracy against the true
+ * velocity, agreement with the same filter in double precision, and the
+ * cost of one update on this host.
+ *
+ * The sensor is 1 m above the ground and reports about every 8 ms with
+ * jitter. Counts are the true displacement plus noise that grows as SQUAL
+ * drops, quantized with the remainder carried as the sensor does, and each
+ * sample is rated by lightModeRate() with the default thresholds. The trace
+ * has a low-quality stretch, a stretch under minConfidence where the counts
+ * are garbage, and a stop long enough to restart the filter.
+ *
+ *   g++ -std=c++11 -O2 -IPAW3902 host/bench_velocity.cpp -o bench_velocity
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "VelocityEstimator.h"
+#include "LightModeController.h"
+#include "BenchRandom.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define HEIGHT_MM 1000
+#define TIMED     0.5 // seconds for the timing run
+
+// True velocity in m/s at t s
+static void truth(double t, double *vx, double *vy)
+{
+  if(t < 2) *vx = 0.75 * t;                            // accelerate to 1.5 m/s
+  else if(t < 5) *vx = 1.5;
+  else if(t < 9) *vx = 1.5 + sin(2 * M_PI * 0.5 * (t - 5)); // weave
+  else if(t < 10.5) *vx = 1.5 * (10.5 - t) / 1.5;      // brake
+  else *vx = 0;
+  *vy = t < 10.5 ? 0.4 * sin(2 * M_PI * 0.2 * t) : 0;
+}
+
+static uint8_t squal(double t)
+{
+  if(t >= 3 && t < 4) return 40;   // poor surface, noisier counts
+  if(t >= 6 && t < 6.3) return 10; // no confidence
+  return 120;
+}
+
+// The same filter in double precision
+struct Reference {
+  double vx, vy, ex, ey, p00, p01, p11, mmPerCount, accel, noise0, init;
+  uint32_t last;
+  bool started;
+
+  Reference(const VelocityConfig &c, uint16_t height)
+  {
+    mmPerCount = height * c.microradPerCount / 1e6;
+    accel = c.accelNoise / 65536.0 / 1000; // mm/ms^2
+    noise0 = c.countNoise / 65536.0;
+    init = c.initVelocity / 65536.0;
+    started = false;
+    last = 0;
+    restart();
+  }
+  void restart()
+  {
+    vx = vy = ex = ey = 0;
+    p00 = noise0 * mmPerCount * noise0 * mmPerCount;
+    p01 = 0;
+    p11 = init * init;
+  }
+  void update(const PAW3902Sample &s, const VelocityConfig &c)
+  {
+    uint32_t dtMicros = s.timestamp - last;
+    last = s.timestamp;
+    if(!started || dtMicros > c.maxGapMicros) { restart(); started = true; return; }
+    double dt = dtMicros / 1000.0, g = accel * dt;
+    double q11 = g * g, q01 = q11 * dt / 2, q00 = q01 * dt / 2;
+    double P00 = p00 + 2 * dt * p01 + dt * dt * p11 + q00, P01 = p01 + dt * p11 + q01, P11 = p11 + q11;
+    if(s.confidence < c.minConfidence || !s.confidence) { p00 = P00; p01 = P01; p11 = P11; return; }
+    double noise = noise0 * 255 / s.confidence, r = noise * mmPerCount;
+    double S = P00 + r * r, k0 = P00 / S, k1 = P01 / S;
+    p00 = (1 - k0) * P00; p01 = (1 - k0) * P01; p11 = P11 - k1 * P01;
+    double ix = s.deltaX * mmPerCount - (ex + vx * dt), iy = s.deltaY * mmPerCount - (ey + vy * dt);
+    ex = (k0 - 1) * ix; vx += k1 * ix;
+    ey = (k0 - 1) * iy; vy += k1 * iy;
+  }
+};
+
+int main()
+{
+  const VelocityConfig &config = velocityDefaults;
+  double mmPerCount = HEIGHT_MM * config.microradPerCount / 1e6;
+  LightModeController lightMode;
+  lightModeInit(&lightMode, NULL);
+
+  // Record the trace
+  std::vector<PAW3902Sample> samples;
+  std::vector<double> trueX, trueY;
+  double t = 0, carryX = 0, carryY = 0;
+  uint32_t us = 1000;
+  while(t < 12)
+  {
+    double dt = (t >= 10.8 && t < 11.2) ? 0.25 : 0.008 + 0.002 * (uniform() - 0.5); // no motion interrupts while stopped
+    double vx0, vy0, vx1, vy1;
+    truth(t, &vx0, &vy0);
+    truth(t + dt, &vx1, &vy1);
+    t += dt;
+    us += (uint32_t)lround(dt * 1e6);
+
+    PAW3902Sample s = {};
+    s.timestamp = us;
+    s.SQUAL = squal(t);
+    s.Shutter = 0x0400;
+    s.RawDataSum = 0x40;
+    s.mode = 0;
+    lightModeRate(&lightMode, &s);
+    double sigma = 0.5 * (s.SQUAL < 100 ? 100.0 / s.SQUAL : 1.0);
+    double cx = (vx0 + vx1) / 2 * dt * 1000 / mmPerCount, cy = (vy0 + vy1) / 2 * dt * 1000 / mmPerCount;
+    if(s.confidence < config.minConfidence) { cx = 40 * (uniform() - 0.5); cy = 40 * (uniform() - 0.5); } // garbage
+    carryX += cx + sigma * gaussian();
+    carryY += cy + sigma * gaussian();
+    s.deltaX = (int16_t)lround(carryX);
+    s.deltaY = (int16_t)lround(carryY);
+    carryX -= s.deltaX;
+    carryY -= s.deltaY;
+    samples.push_back(s);
+    trueX.push_back(vx1);
+    trueY.push_back(vy1);
+  }
+
+  // Replay
+  VelocityEstimator est;
+  velocityInit(&est, &config, HEIGHT_MM);
+  Reference ref(config, HEIGHT_MM);
+  double errRaw = 0, errRef = 0, errQ16 = 0, diffMax = 0;
+  uint32_t counted = 0, last = 0;
+  for(size_t ii = 0; ii < samples.size(); ii++)
+  {
+    velocityUpdate(&est, &samples[ii]);
+    ref.update(samples[ii], config);
+    double qx = est.vx / 65536.0, qy = est.vy / 65536.0;
+    double d = hypot(qx - ref.vx, qy - ref.vy);
+    if(d > diffMax) diffMax = d;
+
+    uint32_t dtMicros = samples[ii].timestamp - last;
+    last = samples[ii].timestamp;
+    if(samples[ii].timestamp < 500000 || samples[ii].confidence < config.minConfidence || dtMicros > config.maxGapMicros) continue;
+    double rx = samples[ii].deltaX * mmPerCount / (dtMicros / 1000.0), ry = samples[ii].deltaY * mmPerCount / (dtMicros / 1000.0);
+    errRaw += pow(rx - trueX[ii], 2) + pow(ry - trueY[ii], 2);
+    errRef += pow(ref.vx - trueX[ii], 2) + pow(ref.vy - trueY[ii], 2);
+    errQ16 += pow(qx - trueX[ii], 2) + pow(qy - trueY[ii], 2);
+    counted++;
+  }
+
+  printf("%zu samples over 12 s, %lu corrected, %lu under minConfidence, %lu restarts\n", samples.size(),
+         (unsigned long)est.updates, (unsigned long)est.skipped, (unsigned long)est.restarts);
+  printf("velocity error, RMS m/s: counts / dt %.4f, double filter %.4f, Q16 filter %.4f\n",
+         sqrt(errRaw / counted), sqrt(errRef / counted), sqrt(errQ16 / counted));
+  printf("Q16 against double: max difference %.5f m/s\n", diffMax);
+
+  // Cost per update
+  uint32_t calls = 0;
+  uint64_t cycles = 0;
+  double elapsed;
+  volatile int32_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  do
+  {
+    velocityInit(&est, &config, HEIGHT_MM);
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t c0 = __rdtsc();
+#endif
+    for(size_t ii = 0; ii < samples.size(); ii++, calls++) velocityUpdate(&est, &samples[ii]);
+#if defined(__x86_64__) || defined(__i386__)
+    cycles += __rdtsc() - c0;
+#endif
+    sink = sink + est.vx;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  } while(elapsed < TIMED);
+  printf("velocityUpdate(): %.1f ns", elapsed * 1e9 / calls);
+  if(cycles) printf(", %.0f TSC cycles", (double)cycles / calls);
+  printf(" per sample on this host\n");
+  return diffMax < 0.01 ? 0 : 1;
+}
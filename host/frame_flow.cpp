@@ -0,0 +1,71 @@
+/* Flow between consecutive recorded frames (FrameFlow.h).
+ *
+ *   frame_flow frame_00000.pgm frame_00001.pgm ...
+ *
+ * takes the 35 x 35 PGMs telemetry_decode writes and prints, for each
+ * consecutive pair, the global vector and the 3 x 3 dense vectors:
+ *
+ *   first second dx dy sad_per_pixel refined | dense dx,dy ... (row by row)
+ *
+ * Frames captured while the sensor is still should give vectors near zero;
+ * the sensor's own deltaX/deltaY count in its resolution units, not pixels,
+ * so compare direction and ratio rather than size.
+ */
+
+#include <stdio.h>
+#include <ctype.h>
+#include "FrameFlow.h"
+
+// Next header number, skipping whitespace and # comments
+static int pgmField(FILE *f)
+{
+  int c, value = -1;
+  while((c = fgetc(f)) == '#' || isspace(c))
+    if(c == '#') while((c = fgetc(f)) != '\n' && c != EOF) { }
+  if(c == EOF || ungetc(c, f) == EOF || fscanf(f, "%d", &value) != 1) return -1;
+  return value;
+}
+
+static bool readPgm(const char *path, uint8_t *frame)
+{
+  FILE *f = fopen(path, "rb");
+  if(!f) return false;
+  bool ok = fgetc(f) == 'P' && fgetc(f) == '5' && pgmField(f) == FRAME_WIDTH && pgmField(f) == FRAME_HEIGHT &&
+            pgmField(f) == 255 && isspace(fgetc(f)) && fread(frame, 1, FRAME_PIXELS, f) == FRAME_PIXELS;
+  fclose(f);
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 3)
+  {
+    fprintf(stderr, "usage: %s frame.pgm frame.pgm [frame.pgm ...]\n", argv[0]);
+    return 2;
+  }
+
+  uint8_t frames[2][FRAME_PIXELS];
+  if(!readPgm(argv[1], frames[0]))
+  {
+    fprintf(stderr, "%s: not a 35 x 35 8-bit PGM\n", argv[1]);
+    return 1;
+  }
+  for(int ii = 2; ii < argc; ii++)
+  {
+    uint8_t *a = frames[ii & 1], *b = frames[(ii + 1) & 1];
+    if(!readPgm(argv[ii], b))
+    {
+      fprintf(stderr, "%s: not a 35 x 35 8-bit PGM\n", argv[ii]);
+      return 1;
+    }
+
+    FrameFlowVector global, dense[FRAMEFLOW_GRID * FRAMEFLOW_GRID];
+    frameFlowGlobal(a, b, &global);
+    frameFlowDense(a, b, dense);
+    printf("%s %s %.2f %.2f %.2f %d |", argv[ii - 1], argv[ii], global.dx, global.dy,
+           (double)global.sad / global.pixels, global.refined);
+    for(int jj = 0; jj < FRAMEFLOW_GRID * FRAMEFLOW_GRID; jj++) printf(" %.2f,%.2f", dense[jj].dx, dense[jj].dy);
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+/* Decode the binary telemetry stream (see Telemetry.h and FrameExport.h).
+ *
+ * Reads raw UART bytes from a file or stdin ("-" or no argument), for example a capture made with
+ * `stty -F /dev/ttyACM0 115200 raw && cat /dev/ttyACM0 > capture.bin`, and
+ * prints one motion sample per line in the trace format bench_lightmode
+ * replays:
+ *
+ *   timestamp deltaX deltaY SQUAL RawDataSum Shutter mode
+ *
+ * Frame dumps are written as frame_<index>.pgm, prefixed by the optional
+ * second argument (e.g. a directory). Packets that fail framing or CRC
+ * (including any text on the same port) and gaps in the sequence number are
+ * counted on stderr.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "Telemetry.h"
+#include "FrameExport.h"
+
+#define MAX_PACKET 2048 // wire bytes kept per packet, longer runs are discarded
+
+int main(int argc, char **argv)
+{
+  FILE *f = argc > 1 && strcmp(argv[1], "-") ? fopen(argv[1], "rb") : stdin;
+  if(!f) { perror(argv[1]); return 1; }
+
+  static uint8_t wire[MAX_PACKET], payload[MAX_PACKET];
+  uint16_t length = 0;
+  const char *prefix = argc > 2 ? argv[2] : "";
+  unsigned long good = 0, bad = 0, frames = 0, other = 0, lost = 0;
+  int expected = -1, c;
+  bool overflow = false;
+
+  while((c = fgetc(f)) != EOF)
+  {
+    if(c != 0)
+    {
+      if(length < MAX_PACKET) wire[length++] = (uint8_t)c;
+      else overflow = true;
+      continue;
+    }
+    if(length == 0) continue; // back-to-back delimiters
+
+    PAW3902Sample sample;
+    FrameHeader header;
+    uint8_t seq, frame[FRAME_PIXELS];
+    uint16_t n = overflow ? 0 : telemetryDecode(wire, length, payload, sizeof(payload));
+    if(n == 0) bad++;
+    else if(frameExportDecode(payload, n, &header, frame))
+    {
+      char name[256];
+      snprintf(name, sizeof(name), "%sframe_%05u.pgm", prefix, header.index);
+      FILE *pgm = fopen(name, "wb");
+      if(!pgm) { perror(name); return 1; }
+      fprintf(pgm, "P5\n# mode %u shutter %u\n%d %d\n255\n", header.mode, header.Shutter, FRAME_WIDTH, FRAME_HEIGHT);
+      fwrite(frame, 1, FRAME_PIXELS, pgm);
+      fclose(pgm);
+      fprintf(stderr, "%s: %u payload bytes%s\n", name, n, header.encoding == FRAME_DELTA_RLE ? ", row delta + RLE" : "");
+      frames++;
+    }
+    else if(!telemetryGetMotion(payload, n, &sample, &seq)) other++;
+    else
+    {
+      if(expected >= 0 && seq != expected) lost += (uint8_t)(seq - expected);
+      expected = (uint8_t)(seq + 1);
+      printf("%lu %d %d %u %u %u %u\n", (unsigned long)sample.timestamp, sample.deltaX, sample.deltaY,
+             sample.SQUAL, sample.RawDataSum, sample.Shutter, sample.mode);
+      good++;
+    }
+    length = 0;
+    overflow = false;
+  }
+
+  fprintf(stderr, "%lu samples, %lu frames, %lu bad packets, %lu other packets, %lu lost by sequence\n", good, frames, bad, other, lost);
+  if(f != stdin) fclose(f);
+  return 0;
+}